@@ -5,17 +5,14 @@
 #include "FileManager.h"
 #include "dsp/AudioEngine.h"
 #include "ui/MainComponent.h"
+#include "cli/CommandLine.h"
 
 //==============================================================================
 class PhiApplication  : public juce::JUCEApplication
 {
 public:
     //==============================================================================
-    PhiApplication() :
-    fileManager(state),
-    audioEngine(state),
-    mainWindow(state, fileManager)
-    {}
+    PhiApplication() {}
 
     const juce::String getApplicationName() override       { return ProjectInfo::projectName; }
     const juce::String getApplicationVersion() override    { return ProjectInfo::versionString; }
@@ -24,17 +21,30 @@ public:
     //==============================================================================
     void initialise (const juce::String& commandLine) override
     {
+        const juce::ArgumentList args (getApplicationName(), getCommandLineParameterArray());
+        
+        // Headless commands (e.g. offline rendering) run without opening any window or audio device
+        if (CommandLine cli; cli.handles(args)) {
+            setApplicationReturnValue(cli.run(args));
+            quit();
+            return;
+        }
+        
+        session = std::make_unique<Session>();
     }
 
     void shutdown() override
     {
-        // Add your application's shutdown code here..
+        session = nullptr;
     }
 
     //==============================================================================
     void systemRequestedQuit() override
     {
-        fileManager.askToSaveThen([] () { quit(); });
+        if (session)
+            session->fileManager.askToSaveThen([] () { quit(); });
+        else
+            quit();
     }
 
     void anotherInstanceStarted (const juce::String& commandLine) override
@@ -90,10 +100,21 @@ public:
     };
 
 private:
-    State state;
-    FileManager fileManager;
-    AudioEngine audioEngine;
-    MainWindow mainWindow;
+    /// Everything the GUI app runs on
+    struct Session {
+        Session() :
+        fileManager(state),
+        audioEngine(state),
+        mainWindow(state, fileManager)
+        {}
+        
+        State state;
+        FileManager fileManager;
+        AudioEngine audioEngine;
+        MainWindow mainWindow;
+    };
+    
+    std::unique_ptr<Session> session;
 };
  
 //==============================================================================
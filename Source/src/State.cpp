@@ -72,14 +72,33 @@ void State::load(juce::File file) {
     if (input.openedOk()) {
         auto newTree = juce::ValueTree::readFromStream(input);
         
-        copyValueTreeRecursively(state, newTree.getChildWithName("ui"));
-        loadEngineState(newTree.getChildWithName("engine"));
+        {
+            // Every module and connection of the patch lands at once
+            ScopedTransaction transaction (*this);
+            
+            copyValueTreeRecursively(state, newTree.getChildWithName("ui"));
+            loadEngineState(newTree.getChildWithName("engine"));
+        }
         
         dirty = false;
         listeners.call([&] (auto& listener) { listener.fileLoaded(file); });
     }
 }
 
+void State::beginTransaction()
+{
+    if (transactionDepth++ == 0)
+        listeners.call([&] (auto& listener) { listener.transactionBegan(); });
+}
+
+void State::endTransaction()
+{
+    jassert(transactionDepth > 0); // <- Unbalanced call!
+    
+    if (--transactionDepth == 0)
+        listeners.call([&] (auto& listener) { listener.transactionEnded(); });
+}
+
 void State::addModule(const std::string& type, int x, int y) {
     auto modulesTree = state.getChildWithName("modules");
     ModuleID moduleID (lastModuleID + 1);
@@ -96,6 +115,8 @@ void State::deleteModule(ModuleID moduleID)
 {
     if (auto moduleNode = getModuleWithID(moduleID); moduleNode.isValid())
     {
+        ScopedTransaction transaction (*this);
+        
         state.getChildWithName("modules").removeChild(moduleNode, nullptr);
         deleteAllModuleConnections(moduleID);
     }
@@ -119,6 +140,18 @@ void State::setModuleColour(ModuleID moduleID, const juce::Colour& colour)
         moduleNode.setProperty("colour", colour.toString(), nullptr);
 }
 
+void State::setModuleVoices(ModuleID moduleID, int numVoices)
+{
+    if (auto moduleNode = getModuleWithID(moduleID); moduleNode.isValid())
+        moduleNode.setProperty("voices", numVoices, nullptr);
+}
+
+void State::setModuleOversampling(ModuleID moduleID, int factor)
+{
+    if (auto moduleNode = getModuleWithID(moduleID); moduleNode.isValid())
+        moduleNode.setProperty("oversampling", factor, nullptr);
+}
+
 void State::deleteAllModuleConnections(ModuleID moduleID)
 {
     auto connectionsTree = state.getChildWithName("connections");
@@ -216,6 +249,16 @@ void State::valueTreePropertyChanged (juce::ValueTree& tree, const juce::Identif
             auto colour = juce::Colour::fromString(val.toString());
             listeners.call([&] (auto& listener) { listener.moduleColourChanged(moduleID, colour); });
         }
+        else if (key == "voices")
+        {
+            int numVoices = val;
+            listeners.call([&] (auto& listener) { listener.moduleVoicesChanged(moduleID, numVoices); });
+        }
+        else if (key == "oversampling")
+        {
+            int factor = val;
+            listeners.call([&] (auto& listener) { listener.moduleOversamplingChanged(moduleID, factor); });
+        }
     }
     else if (tree.getParent().getType().toString() == "connections")
     {
@@ -241,7 +284,11 @@ void State::valueTreeChildAdded (juce::ValueTree& parent, juce::ValueTree& tree)
             lastModuleID = moduleID;
         
         auto processor = Modules::getInfoFromFromName(tree.getProperty("type"))->create();
-        newModuleUICreated(processor->createUI(), moduleID);
+        
+        // Headless sessions (e.g. offline rendering) don't register a UI hook
+        if (newModuleUICreated)
+            newModuleUICreated(processor->createUI(), moduleID);
+        
         newProcessorCreated(std::move(processor), moduleID);
         
         listeners.call([&] (auto& listener) { listener.moduleAdded(moduleID); });
@@ -162,7 +162,7 @@ struct State : juce::ValueTree::Listener {
     ~State();
     // ========================================================================
     
-    /// Hook for the Patcher to receive the module UI
+    /// Hook for the Patcher to receive the module UI (optional, no UI is created when unset)
     std::function<void(std::unique_ptr<ModuleUI>, ModuleID)> newModuleUICreated;
     /// Hook for the Engine to receive the module processor
     std::function<void(std::unique_ptr<ModuleProcessor>, ModuleID)> newProcessorCreated;
@@ -177,6 +177,20 @@ struct State : juce::ValueTree::Listener {
     void save(juce::File);
     void load(juce::File);
     
+    /** Groups the changes that follow until the matching endTransaction(), so listeners can apply them all at once
+        (e.g. the engine compiles a single render plan for a whole patch). Transactions can be nested, only the outermost one is reported */
+    void beginTransaction();
+    void endTransaction();
+    
+    /// Keeps a transaction open for its lifetime
+    struct ScopedTransaction {
+        explicit ScopedTransaction(State& state) : state(state) { state.beginTransaction(); }
+        ~ScopedTransaction() { state.endTransaction(); }
+        
+        State& state;
+        JUCE_DECLARE_NON_COPYABLE (ScopedTransaction)
+    };
+    
     // State Setters
     void addModule(const std::string& type, int x, int y);
     void deleteModule(ModuleID moduleID);
@@ -184,6 +198,8 @@ struct State : juce::ValueTree::Listener {
     void setModuleEnabled(ModuleID, bool isEnabled);
     void setModuleBounds(ModuleID, const juce::Rectangle<int>& bounds);
     void setModuleColour(ModuleID, const juce::Colour& colour);
+    void setModuleVoices(ModuleID, int numVoices);
+    void setModuleOversampling(ModuleID, int factor);
     
     void createConnection(ConnectionID);
     void deleteConnection(ConnectionID);
@@ -205,6 +221,8 @@ struct State : juce::ValueTree::Listener {
         virtual void moduleEnabledChanged(ModuleID, bool isEnabled) {};
         virtual void moduleBoundsChanged(ModuleID, const juce::Rectangle<int>& bounds) {};
         virtual void moduleColourChanged(ModuleID, const juce::Colour& colour) {};
+        virtual void moduleVoicesChanged(ModuleID, int numVoices) {};
+        virtual void moduleOversamplingChanged(ModuleID, int factor) {};
         
         virtual void connectionCreated(ConnectionID) {};
         virtual void connectionDeleted(ConnectionID) {};
@@ -216,6 +234,9 @@ struct State : juce::ValueTree::Listener {
         
         virtual void fileLoaded(juce::File) {}
         virtual void fileSaved(juce::File) {}
+        
+        virtual void transactionBegan() {}
+        virtual void transactionEnded() {}
     };
     
     void addListener (Listener* listener) { listeners.add(listener); }
@@ -231,6 +252,9 @@ private:
     
     bool dirty = false;
     
+    /// How many transactions are open
+    int transactionDepth = 0;
+    
     void deleteAllModuleConnections(ModuleID);
     
     juce::ValueTree getModuleWithID (ModuleID);
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    CommandLine.h
+    Created: 18 Oct 2026 10:40:02am
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "ModuleBenchmark.h"
+#include "FastMathCheck.h"
+
+/// The headless commands, they run instead of the GUI when the first argument matches one of them
+struct CommandLine : juce::ConsoleApplication
+{
+    CommandLine()
+    {
+        addHelpCommand("--help", "Usage:", false);
+
+        addCommand({
+            "--render",
+            "--render <patch.phi> [output.wav] [--sample-rate=48000] [--block-size=512] [--duration=10] [--threads=N] [--feedback-block-size=N]",
+            "Renders a patch offline, as fast as possible",
+            "Renders a patch without an audio device and writes the result to a 24-bit WAV file.\n"
+            "When no output is given, the patch is only rendered to measure its throughput.\n"
+            "Use --threads=1 to render every module on a single thread.\n"
+            "Feedback loops delay by one block, --feedback-block-size=N renders patches with loops in blocks of N samples.",
+            [] (const juce::ArgumentList& args) { render(args); }
+        });
+        
+        addCommand({
+            "--benchmark",
+            "--benchmark [--module=String] [--duration=0.5]",
+            "Measures the DSP cost of each module",
+            "Runs every module on its own (no graph) with unpatched, control-rate and audio-rate inlets,\n"
+            "across sample rates from 44.1 kHz to 192 kHz and block sizes from 16 to 4096 samples.",
+            [] (const juce::ArgumentList& args) { benchmark(args); }
+        });
+        
+        addCommand({
+            "--fast-math",
+            "--fast-math",
+            "Checks the fast-math kernels against the standard library",
+            "Sweeps every fastmath kernel (dsp/Utils.h) over its documented range, reporting the worst error\n"
+            "and the cost per sample on whole arrays. Fails if any kernel exceeds its documented error bound.\n"
+            "Then renders every LFO wave and CV combination with LFO::render() and LFO::next(), and compares them.",
+            [] (const juce::ArgumentList&) { checkFastMath(); }
+        });
+    }
+
+    /// Returns true if the arguments ask for a headless command
+    bool handles(const juce::ArgumentList& args) const { return findCommand(args, true) != nullptr; }
+
+    /// Runs the matching command and returns the process exit code
+    int run(const juce::ArgumentList& args) const { return findAndRunCommand(args, true); }
+
+private:
+    static void render(const juce::ArgumentList& args)
+    {
+        if (args.size() < 2 || args[1].isOption())
+            fail("Missing patch file, see --help");
+
+        OfflineRenderer::Settings settings;
+        settings.patch = args[1].resolveAsFile();
+
+        if (args.size() > 2 && !args[2].isOption())
+            settings.output = args[2].resolveAsFile();
+
+        settings.sampleRate = getOption(args, "--sample-rate", settings.sampleRate);
+        settings.blockSize = (int)getOption(args, "--block-size", settings.blockSize);
+        settings.duration = getOption(args, "--duration", settings.duration);
+        settings.numThreads = (int)getOption(args, "--threads", settings.numThreads);
+        settings.feedbackBlockSize = (int)getOption(args, "--feedback-block-size", settings.feedbackBlockSize);
+
+        OfflineRenderer::Stats stats;
+
+        if (auto result = OfflineRenderer::render(settings, stats); result.failed())
+            fail(result.getErrorMessage());
+
+        std::cout << "Rendered " << stats.numSamples << " samples"
+                  << " (" << settings.sampleRate << " Hz, block size " << settings.blockSize << ")"
+                  << " in " << stats.renderSeconds << " s"
+                  << " - " << stats.getRealtimeFactor(settings.sampleRate) << "x real time" << std::endl;
+    }
+
+    static void benchmark(const juce::ArgumentList& args)
+    {
+        ModuleBenchmark::Settings settings;
+        settings.module = args.getValueForOption("--module");
+        settings.duration = getOption(args, "--duration", settings.duration);
+        
+        auto result = ModuleBenchmark::run(settings, [] (const ModuleBenchmark::Result& measurement) {
+            std::cout << measurement.toString() << std::endl;
+        });
+        
+        if (result.failed())
+            fail(result.getErrorMessage());
+    }
+    
+    static void checkFastMath()
+    {
+        auto result = FastMathCheck::run([] (const FastMathCheck::Result& measurement) {
+            std::cout << measurement.toString() << std::endl;
+        });
+        
+        auto lfoResult = FastMathCheck::runLFO([] (const FastMathCheck::LFOResult& measurement) {
+            std::cout << measurement.toString() << std::endl;
+        });
+        
+        if (result.failed())
+            fail(result.getErrorMessage());
+        
+        if (lfoResult.failed())
+            fail(lfoResult.getErrorMessage());
+    }
+    
+    static double getOption(const juce::ArgumentList& args, const juce::String& option, double defaultValue)
+    {
+        if (!args.containsOption(option))
+            return defaultValue;
+
+        return args.getValueForOption(option).getDoubleValue();
+    }
+};
@@ -0,0 +1,309 @@
+/*
+  ==============================================================================
+
+    FastMathCheck.cpp
+    Created: 18 Oct 2026 7:14:26pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#include "FastMathCheck.h"
+#include "../dsp/Utils.h"
+#include "../modules/LFO/LFO.h"
+
+namespace {
+
+using Block = void (*)(const float* in, float* out, int numSamples);
+
+struct Kernel {
+    const char* name;
+    double rangeStart, rangeEnd;
+    bool isRelative;
+
+    float (*fast)(float);
+    double (*reference)(double);
+
+    /// The documented error bound for an input
+    double (*bound)(double x, double reference);
+
+    /// Whole array versions, to measure what module loops get (the fast one vectorises, the standard one can't)
+    Block fastBlock, standardBlock;
+};
+
+const std::vector<Kernel> kernels {
+    { "exp2", -126.0, 126.0, true,
+      [] (float x) { return fastmath::exp2(x); },
+      [] (double x) { return std::exp2(x); },
+      [] (double, double) { return 3e-7; },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::exp2>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::exp2(in[i]); } },
+
+    { "log2", 1e-30, 1e30, false,
+      [] (float x) { return fastmath::log2(x); },
+      [] (double x) { return std::log2(x); },
+      [] (double, double y) { return 4e-7 + 1e-7 * std::abs(y); },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::log2>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::log2(in[i]); } },
+
+    { "pow(5)", -8.0, 8.0, true,
+      [] (float x) { return fastmath::pow(5.0f, x); },
+      [] (double x) { return std::pow(5.0, x); },
+      [] (double x, double) { return 3e-7 + 1e-7 * std::abs(x * std::log2(5.0)); },
+      [] (const float* in, float* out, int n) { fastmath::Pow(5.0f).process(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::pow(5.0f, in[i]); } },
+
+    { "sin", -1e5, 1e5, false,
+      [] (float x) { return fastmath::sin(x); },
+      [] (double x) { return std::sin(x); },
+      [] (double x, double) { return 5e-7 + 2e-11 * std::abs(x); },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::sin>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::sin(in[i]); } },
+
+    { "cos", -1e5, 1e5, false,
+      [] (float x) { return fastmath::cos(x); },
+      [] (double x) { return std::cos(x); },
+      [] (double x, double) { return 5e-7 + 2e-11 * std::abs(x); },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::cos>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::cos(in[i]); } },
+
+    { "tanh", -50.0, 50.0, false,
+      [] (float x) { return fastmath::tanh(x); },
+      [] (double x) { return std::tanh(x); },
+      [] (double, double) { return 3e-7; },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::tanh>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::tanh(in[i]); } },
+
+    { "db_to_a", -140.0, 40.0, true,
+      [] (float x) { return fastmath::db_to_a(x); },
+      [] (double x) { return std::pow(10.0, x * 0.05); },
+      [] (double x, double) { return 3e-7 + 2e-8 * std::abs(x); },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::db_to_a>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = db_to_a(in[i]); } },
+
+    { "a_to_db", 1e-7, 100.0, false,
+      [] (float x) { return fastmath::a_to_db(x); },
+      [] (double x) { return 20.0 * std::log10(x); },
+      [] (double, double y) { return 3e-6 + 2e-7 * std::abs(y); },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::a_to_db>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = a_to_db(in[i]); } },
+
+    { "floor", -1e6, 1e6, false,
+      [] (float x) { return fastmath::floor(x); },
+      [] (double x) { return std::floor(x); },
+      [] (double, double) { return 0.0; },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::floor>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = std::floor(in[i]); } },
+
+    { "frac", -1e3, 1e3, false,
+      [] (float x) { return fastmath::frac(x); },
+      [] (double x) { return x - std::floor(x); },
+      [] (double, double) { return 1e-7; },
+      [] (const float* in, float* out, int n) { fastmath::process<fastmath::frac>(in, out, n); },
+      [] (const float* in, float* out, int n) { for (int i = 0; i < n; ++i) out[i] = frac(in[i]); } }
+};
+
+/// Returns the nanoseconds per sample spent running `block` over the inputs, a few times over
+double timeBlock(Block block, const std::vector<float>& inputs, std::vector<float>& outputs)
+{
+    constexpr int numRepetitions = 200;
+    const auto start = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < numRepetitions; ++i)
+        block(inputs.data(), outputs.data(), (int)inputs.size());
+
+    const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    return seconds * 1e9 / ((double)numRepetitions * (double)inputs.size());
+}
+
+/// A different sine (within a typical CV range) for each inlet
+std::vector<float> makeCV(int numSamples, double frequency, float amplitude, double sampleRate)
+{
+    std::vector<float> cv ((size_t)numSamples);
+    
+    for (int n = 0; n < numSamples; ++n)
+        cv[(size_t)n] = amplitude * (float)std::sin(juce::MathConstants<double>::twoPi * frequency * n / sampleRate);
+    
+    return cv;
+}
+
+} // namespace
+
+juce::String FastMathCheck::Result::toString() const
+{
+    return kernel.paddedRight(' ', 10)
+         + ("[" + juce::String(rangeStart) + ", " + juce::String(rangeEnd) + "]").paddedRight(' ', 18)
+         + (juce::String(maxError, 10) + (isRelative ? " rel" : " abs")).paddedLeft(' ', 18)
+         + (" at " + juce::String(maxErrorInput)).paddedRight(' ', 16)
+         + (withinBound ? "   ok    " : "   FAILED")
+         + (juce::String(fastNanosecondsPerSample, 2) + " ns/sample").paddedLeft(' ', 16)
+         + (" (std: " + juce::String(standardNanosecondsPerSample, 2) + ")");
+}
+
+juce::Result FastMathCheck::run(std::function<void(const Result&)> onResult)
+{
+    constexpr int numPoints = 1 << 21;
+    bool allWithinBounds = true;
+
+    for (auto& kernel : kernels) {
+        Result result { kernel.name, kernel.rangeStart, kernel.rangeEnd, 0.0, 0.0, kernel.isRelative, true, 0.0, 0.0 };
+
+        // Wide ranges are swept logarithmically, so small inputs get as much coverage as large ones
+        const bool logarithmic = kernel.rangeStart > 0.0 && kernel.rangeEnd / kernel.rangeStart > 1e3;
+
+        std::vector<float> inputs ((size_t)numPoints);
+
+        for (int i = 0; i < numPoints; ++i) {
+            const double position = (double)i / (numPoints - 1);
+            inputs[(size_t)i] = (float)(logarithmic ? kernel.rangeStart * std::pow(kernel.rangeEnd / kernel.rangeStart, position)
+                                                    : kernel.rangeStart + (kernel.rangeEnd - kernel.rangeStart) * position);
+        }
+
+        // ============ Accuracy =======================
+
+        for (float input : inputs) {
+            // The reference gets the exact same (float) input
+            const double reference = kernel.reference((double)input);
+            double error = std::abs((double)kernel.fast(input) - reference);
+
+            if (kernel.isRelative)
+                error /= std::abs(reference);
+
+            if (error > result.maxError) {
+                result.maxError = error;
+                result.maxErrorInput = input;
+            }
+
+            if (error > kernel.bound((double)input, reference))
+                result.withinBound = false;
+        }
+
+        // ============ Speed =======================
+
+        // A typical block, spread over the whole range
+        std::vector<float> block (4096), outputs (block.size());
+
+        for (size_t i = 0; i < block.size(); ++i)
+            block[i] = inputs[i * (inputs.size() / block.size())];
+
+        result.fastNanosecondsPerSample = timeBlock(kernel.fastBlock, block, outputs);
+        result.standardNanosecondsPerSample = timeBlock(kernel.standardBlock, block, outputs);
+
+        allWithinBounds &= result.withinBound;
+        onResult(result);
+    }
+
+    return allWithinBounds ? juce::Result::ok() : juce::Result::fail("Some kernels exceeded their documented error bound");
+}
+
+juce::String FastMathCheck::LFOResult::toString() const
+{
+    return ("lfo " + wave.toLowerCase()).paddedRight(' ', 14)
+         + ("shape " + juce::String(shape, 1)).paddedRight(' ', 12)
+         + (hasRateCV ? "rate cv  " : "         ")
+         + (hasShapeCV ? "shape cv " : "         ")
+         + (juce::String(maxError, 10) + " abs").paddedLeft(' ', 18)
+         + (" at " + juce::String(maxErrorSample)).paddedRight(' ', 12)
+         + (withinBound ? "   ok    " : "   FAILED")
+         + (juce::String(renderNanosecondsPerSample, 2) + " ns/sample").paddedLeft(' ', 16)
+         + (" (next: " + juce::String(nextNanosecondsPerSample, 2) + ")");
+}
+
+juce::Result FastMathCheck::runLFO(std::function<void(const LFOResult&)> onResult)
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 256, numBlocks = 1000, numSamples = blockSize * numBlocks;
+    constexpr double rate = 0.5;
+    constexpr float phase = 0.25f;
+    
+    // Shape CV stays within (-1, 1) around the shapes it's added to, the triangle's slopes are infinite at the ends
+    const auto rateCV = makeCV(numSamples, 3.0, 0.3f, sampleRate);
+    const auto shapeCV = makeCV(numSamples, 2.0, 0.4f, sampleRate);
+    
+    bool allWithinBounds = true;
+    
+    for (int waveIndex = 0; waveIndex < LFO::WAVE_STRINGS.size(); ++waveIndex) {
+        for (float shape : { -0.9f, -0.5f, 0.0f, 0.5f, 0.9f }) {
+            for (int combination = 0; combination < 4; ++combination) {
+                const bool hasRateCV = (combination & 1) != 0, hasShapeCV = (combination & 2) != 0;
+                
+                if (hasShapeCV && std::abs(shape) > 0.5f) continue;
+                
+                const auto wave = (LFO::Wave)waveIndex;
+                std::vector<float> rendered ((size_t)numSamples), reference ((size_t)numSamples), scratch ((size_t)blockSize);
+                
+                // Both get the same seed, so the random wave draws the same values
+                auto makeLFO = [&] {
+                    auto lfo = std::make_unique<LFO>();
+                    lfo->prepare(sampleRate, 1);
+                    lfo->set_wave(wave);
+                    lfo->set_rate(rate);
+                    lfo->set_shape(shape);
+                    lfo->set_phase(phase);
+                    return lfo;
+                };
+                
+                // Like LFOProcessor does, the CV comes in blocks
+                auto renderBlocks = [&] (LFO& lfo, std::vector<float>& out) {
+                    for (int start = 0; start < numSamples; start += blockSize)
+                        lfo.render(out.data() + start,
+                                   hasRateCV ? rateCV.data() + start : nullptr,
+                                   hasShapeCV ? shapeCV.data() + start : nullptr,
+                                   blockSize);
+                };
+                
+                // What the processor used to do: the rate and shape set for every sample
+                auto renderSamples = [&] (LFO& lfo, std::vector<float>& out) {
+                    for (int n = 0; n < numSamples; ++n) {
+                        if (hasRateCV) lfo.set_rate(clip(rate + (double)rateCV[(size_t)n], 0.0, 1.0));
+                        lfo.set_shape(clip(shape + (hasShapeCV ? shapeCV[(size_t)n] : 0.0f), -1.0f, 1.0f));
+                        out[(size_t)n] = lfo.next();
+                    }
+                };
+                
+                LFOResult result { LFO::WAVE_STRINGS[waveIndex], shape, hasRateCV, hasShapeCV, 0.0, 0, true, 0.0, 0.0 };
+                
+                // ============ Accuracy =======================
+                
+                renderBlocks(*makeLFO(), rendered);
+                renderSamples(*makeLFO(), reference);
+                
+                for (int n = 0; n < numSamples; ++n) {
+                    double error = std::abs((double)rendered[(size_t)n] - (double)reference[(size_t)n]);
+                    
+                    if (wave == LFO::Wave::Square) {
+                        // An edge may land on the neighbouring sample
+                        for (int neighbour : { n - 1, n + 1 })
+                            if (neighbour >= 0 && neighbour < numSamples)
+                                error = std::min(error, std::abs((double)rendered[(size_t)n] - (double)reference[(size_t)neighbour]));
+                    }
+                    
+                    if (error > result.maxError) {
+                        result.maxError = error;
+                        result.maxErrorSample = n;
+                    }
+                }
+                
+                result.withinBound = result.maxError <= lfoErrorBound;
+                
+                // ============ Speed =======================
+                
+                auto timeRender = [&] (auto&& renderAll, std::vector<float>& out) {
+                    auto lfo = makeLFO();
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    renderAll(*lfo, out);
+                    const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                    return seconds * 1e9 / (double)numSamples;
+                };
+                
+                result.renderNanosecondsPerSample = timeRender(renderBlocks, rendered);
+                result.nextNanosecondsPerSample = timeRender(renderSamples, reference);
+                
+                allWithinBounds &= result.withinBound;
+                onResult(result);
+            }
+        }
+    }
+    
+    return allWithinBounds ? juce::Result::ok() : juce::Result::fail("LFO::render() strayed from LFO::next()");
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    FastMathCheck.h
+    Created: 18 Oct 2026 7:14:26pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Checks every fastmath kernel (dsp/Utils.h) against the standard library: error over its documented range and speed on whole arrays.
+    Also checks the LFO's block rendering, which is built on them, against its sample by sample version */
+struct FastMathCheck
+{
+    struct Result {
+        juce::String kernel;
+        double rangeStart, rangeEnd;
+
+        /// The worst error found, and the input it happened at
+        double maxError, maxErrorInput;
+        bool isRelative;
+        /// Whether every input stayed within the documented error bound
+        bool withinBound;
+
+        double fastNanosecondsPerSample;
+        double standardNanosecondsPerSample;
+
+        juce::String toString() const;
+    };
+
+    /**
+     * Runs every kernel, calling back with each result as soon as it's measured.
+     * @return Fails if any kernel exceeded its documented error bound
+     */
+    static juce::Result run(std::function<void(const Result&)> onResult);
+    
+    /// LFO::render() (built on the kernels) against LFO::next(), for one wave, shape and CV combination
+    struct LFOResult {
+        juce::String wave;
+        float shape;
+        bool hasRateCV, hasShapeCV;
+        
+        /// The worst difference from next(), and the sample it happened at
+        double maxError;
+        int maxErrorSample;
+        /// Whether every sample stayed within lfoErrorBound
+        bool withinBound;
+        
+        double renderNanosecondsPerSample;
+        double nextNanosecondsPerSample;
+        
+        juce::String toString() const;
+    };
+    
+    /// How far render() may stray from next(). Jumps (the square's edges) may land a sample apart, from rounding the phase differently
+    static constexpr double lfoErrorBound = 1e-4;
+    
+    /**
+     * Renders every LFO wave with and without rate and shape CV, both ways, calling back with each result as soon as it's measured.
+     * @return Fails if render() strayed from next() by more than lfoErrorBound
+     */
+    static juce::Result runLFO(std::function<void(const LFOResult&)> onResult);
+};
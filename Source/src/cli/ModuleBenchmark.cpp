@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    ModuleBenchmark.cpp
+    Created: 18 Oct 2026 2:05:51pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#include "ModuleBenchmark.h"
+#include "../modules/Modules.h"
+
+namespace {
+
+using CV = ModuleBenchmark::CV;
+
+/** Fills the inlets with silence, or with a different sine (within a typical CV range) for each inlet.
+    At control rate the sine is slow, and it's drawn as a straight line across each block */
+void fillInlets(juce::AudioBuffer<float>& source, int numInlets, CV cv, double sampleRate, int blockSize)
+{
+    source.clear();
+
+    if (cv == CV::Silent) return;
+
+    for (int inlet = 0; inlet < numInlets; ++inlet) {
+        float* samples = source.getWritePointer(inlet);
+        
+        if (cv == CV::AudioRate) {
+            const double increment = juce::MathConstants<double>::twoPi * 110.0 * (inlet + 1) / sampleRate;
+
+            for (int n = 0; n < source.getNumSamples(); ++n)
+                samples[n] = 0.5f * (float)std::sin(increment * n);
+            
+            continue;
+        }
+        
+        // Slow enough to stay control rate in the largest blocks
+        const double increment = juce::MathConstants<double>::twoPi * 0.05 / sampleRate;
+        const double phase = inlet * 0.5;
+        
+        for (int start = 0; start < source.getNumSamples(); start += blockSize) {
+            const float first = 0.5f * (float)std::sin(increment * start + phase);
+            const float last = 0.5f * (float)std::sin(increment * (start + blockSize - 1) + phase);
+            
+            for (int n = 0; n < blockSize; ++n)
+                samples[start + n] = first + (last - first) * (float)n / (float)std::max(1, blockSize - 1);
+        }
+    }
+}
+
+/// What the render plan would tell the module: which inlets are patched, and which of those are control rate
+ModuleProcessor::Connections getConnections(CV cv)
+{
+    switch (cv) {
+        case CV::Silent: return { 0u, ~0u, ~0u };
+        case CV::ControlRate: return { ~0u, ~0u, ~0u };
+        case CV::AudioRate: return { ~0u, ~0u, 0u };
+    }
+    
+    return {};
+}
+
+template <class ProcessorType>
+void benchmarkModule(const juce::String& name,
+                     const ModuleBenchmark::Settings& settings,
+                     const std::function<void(const ModuleBenchmark::Result&)>& onResult)
+{
+    ProcessorType module;
+
+    // Go through the same entry points the engine uses, so anything ModuleProcessor does around process() is measured too
+    juce::AudioProcessor& processor = module;
+    juce::MidiBuffer midi;
+
+    const int numInlets = processor.getTotalNumInputChannels();
+    const int numChannels = std::max(numInlets, processor.getTotalNumOutputChannels());
+
+    juce::ScopedNoDenormals noDenormals;
+
+    for (auto sampleRate : settings.sampleRates) {
+        for (auto blockSize : settings.blockSizes) {
+            for (auto cv : settings.cvModes) {
+                const int numBlocks = std::max(1, (int)std::ceil(settings.duration * sampleRate / blockSize));
+
+                juce::AudioBuffer<float> source (numChannels, numBlocks * blockSize);
+                juce::AudioBuffer<float> buffer (numChannels, blockSize);
+                fillInlets(source, numInlets, cv, sampleRate, blockSize);
+
+                processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+                processor.prepareToPlay(sampleRate, blockSize);
+                module.setConnections(getConnections(cv));
+
+                // Returns the seconds spent, the inlets are refilled before every block since modules process in place
+                auto render = [&] (bool callProcess) {
+                    const auto start = juce::Time::getHighResolutionTicks();
+
+                    for (int block = 0; block < numBlocks; ++block) {
+                        for (int channel = 0; channel < numChannels; ++channel)
+                            buffer.copyFrom(channel, 0, source, channel, block * blockSize, blockSize);
+
+                        if (callProcess)
+                            processor.processBlock(buffer, midi);
+                    }
+
+                    return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+                };
+
+                // Warm up caches and let the module settle
+                render(true);
+
+                // Don't count the time spent refilling the inlets
+                const double seconds = std::max(1e-9, render(true) - render(false));
+
+                onResult({
+                    name,
+                    sampleRate,
+                    blockSize,
+                    cv,
+                    seconds * 1e9 / ((double)numBlocks * blockSize),
+                    numBlocks / seconds
+                });
+            }
+        }
+    }
+
+    processor.releaseResources();
+}
+
+} // namespace
+
+juce::String ModuleBenchmark::Result::toString() const
+{
+    return module.paddedRight(' ', 10)
+         + (juce::String(sampleRate * 0.001, 1) + " kHz").paddedLeft(' ', 10)
+         + juce::String(blockSize).paddedLeft(' ', 6)
+         + (cv == CV::Silent ? "   silent      " : cv == CV::ControlRate ? "   control-rate" : "   audio-rate  ")
+         + (juce::String(nanosecondsPerSample, 2) + " ns/sample").paddedLeft(' ', 18)
+         + (juce::String(blocksPerSecond, 0) + " blocks/s").paddedLeft(' ', 18);
+}
+
+juce::Result ModuleBenchmark::run(const Settings& settings, std::function<void(const Result&)> onResult)
+{
+    if (settings.module.isNotEmpty()
+        && std::find(moduleNames.begin(), moduleNames.end(), settings.module.toStdString()) == moduleNames.end())
+        return juce::Result::fail("Unknown module: " + settings.module);
+
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        ([&] {
+            const juce::String name (moduleNames[I]);
+
+            if (settings.module.isEmpty() || settings.module == name)
+                benchmarkModule<std::tuple_element_t<I, ModuleTypeList>>(name, settings, onResult);
+        }(), ...);
+    }(std::make_index_sequence<std::tuple_size_v<ModuleTypeList>>{});
+
+    return juce::Result::ok();
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    ModuleBenchmark.h
+    Created: 18 Oct 2026 2:05:51pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/// Measures the DSP cost of every module in ModuleTypeList, one module at a time and without the graph
+struct ModuleBenchmark
+{
+    /** What the module's inlets are fed with:
+        - Silent: nothing is patched, so the module can skip the work its inlets would need
+        - ControlRate: slow lines, patched and marked as control rate (like the render plan does when it detects them)
+        - AudioRate: sines, patched at audio rate */
+    enum class CV { Silent, ControlRate, AudioRate };
+
+    struct Settings {
+        /// Only benchmark the module with this name (all modules when empty)
+        juce::String module;
+        /// Seconds of audio to render for each configuration
+        double duration = 0.5;
+
+        std::vector<double> sampleRates { 44100.0, 48000.0, 96000.0, 192000.0 };
+        std::vector<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+        std::vector<CV> cvModes { CV::Silent, CV::ControlRate, CV::AudioRate };
+    };
+
+    struct Result {
+        juce::String module;
+        double sampleRate;
+        int blockSize;
+        CV cv;
+
+        double nanosecondsPerSample;
+        double blocksPerSecond;
+
+        juce::String toString() const;
+    };
+
+    /**
+     * Runs every configuration, calling back with each result as soon as it's measured.
+     * @return Fails if the requested module doesn't exist
+     */
+    static juce::Result run(const Settings&, std::function<void(const Result&)> onResult);
+};
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Created: 18 Oct 2026 10:12:37am
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "../State.h"
+#include "../dsp/AudioEngine.h"
+
+juce::Result OfflineRenderer::render(const Settings& settings, Stats& stats)
+{
+    if (!settings.patch.existsAsFile())
+        return juce::Result::fail("Patch not found: " + settings.patch.getFullPathName());
+
+    if (settings.sampleRate <= 0.0 || settings.blockSize <= 0 || settings.duration <= 0.0)
+        return juce::Result::fail("Sample rate, block size and duration must be positive");
+
+    State state;
+    AudioEngine engine (state, AudioEngine::Playback::Offline, settings.numThreads);
+    engine.setFeedbackBlockSize(settings.feedbackBlockSize);
+
+    // Builds the graph and restores every module's parameters
+    state.load(settings.patch);
+
+    // We drive the engine directly, just like the AudioProcessorPlayer would
+    juce::AudioProcessor& processor = engine;
+    const int numChannels = AudioEngine::numOutputChannels;
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (settings.output != juce::File()) {
+        settings.output.deleteFile();
+
+        std::unique_ptr<juce::OutputStream> stream = settings.output.createOutputStream();
+        if (stream == nullptr)
+            return juce::Result::fail("Can't write to " + settings.output.getFullPathName());
+
+        juce::WavAudioFormat wav;
+        writer.reset(wav.createWriterFor(stream.get(), settings.sampleRate, (unsigned int)numChannels, 24, {}, 0));
+        if (writer == nullptr)
+            return juce::Result::fail("Unsupported WAV format: " + juce::String(settings.sampleRate) + " Hz");
+
+        // The writer now owns the stream
+        stream.release();
+    }
+
+    processor.setPlayConfigDetails(0, numChannels, settings.sampleRate, settings.blockSize);
+    processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+
+    juce::AudioBuffer<float> buffer (numChannels, settings.blockSize);
+    juce::MidiBuffer midi;
+
+    const auto totalSamples = (juce::int64)std::ceil(settings.duration * settings.sampleRate);
+    stats = {};
+
+    while (stats.numSamples < totalSamples) {
+        const int numSamples = (int)std::min<juce::int64>(settings.blockSize, totalSamples - stats.numSamples);
+
+        buffer.setSize(numChannels, numSamples, false, false, true);
+        buffer.clear();
+
+        const double start = juce::Time::getMillisecondCounterHiRes();
+        processor.processBlock(buffer, midi);
+        stats.renderSeconds += (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+        if (writer != nullptr && !writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+            return juce::Result::fail("Failed writing to " + settings.output.getFullPathName());
+
+        stats.numSamples += numSamples;
+    }
+
+    processor.releaseResources();
+
+    return juce::Result::ok();
+}
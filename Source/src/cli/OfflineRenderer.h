@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Created: 18 Oct 2026 10:12:37am
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/// Renders a patch without an audio device, pulling blocks from the engine as fast as the CPU allows
+struct OfflineRenderer
+{
+    struct Settings {
+        /// The .phi file to render
+        juce::File patch;
+        /// The WAV file to write, leave empty to only measure the render time
+        juce::File output;
+
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        /// Length of the render, in seconds
+        double duration = 10.0;
+        /// Threads rendering the graph (including the calling thread), 0 keeps the engine's default
+        int numThreads = 0;
+        /// Block size for patches with feedback loops (their latency), 0 keeps blockSize
+        int feedbackBlockSize = 0;
+    };
+
+    struct Stats {
+        juce::int64 numSamples = 0;
+        /// Time spent inside the engine (file writing excluded)
+        double renderSeconds = 0.0;
+
+        /// How many seconds of audio were rendered per second of CPU time
+        double getRealtimeFactor(double sampleRate) const {
+            return renderSeconds > 0.0 ? ((double)numSamples / sampleRate) / renderSeconds : 0.0;
+        }
+    };
+
+    /**
+     * Loads the patch through State::load (the same path used by the app) and renders it.
+     * @return The reason for failing, if the patch or output can't be opened
+     */
+    static juce::Result render(const Settings&, Stats&);
+};
@@ -10,21 +10,33 @@
 
 #include "AudioEngine.h"
 
-AudioEngine::AudioEngine(State& state) : state(state)
+AudioEngine::AudioEngine(State& state, Playback playback, int numThreads) :
+state(state),
+executor(numThreads > 0 ? numThreads : juce::SystemStats::getNumPhysicalCpuCores())
 {
-    // Initialise the device manager and add the player
-    deviceManager.initialise(2, 2, nullptr, true, juce::String(), nullptr);
-    deviceManager.addAudioCallback(&player);
-    player.setProcessor(this);
+    if (playback == Playback::Device) {
+        // Initialise the device manager and add the player
+        deviceManager.initialise(2, numOutputChannels, nullptr, true, juce::String(), nullptr);
+        deviceManager.addAudioCallback(&player);
+        player.setProcessor(this);
+    } else {
+        // No player will configure us, the output node must still get its channels before it's created
+        setPlayConfigDetails(0, numOutputChannels, getSampleRate(), getBlockSize());
+    }
     
     resetEngine();
     
     state.newProcessorCreated = [&] (std::unique_ptr<ModuleProcessor> processor, auto moduleID) {
         bool isOutput = processor->isOutput;
-        if (auto node = addNode(std::move(processor), std::make_optional<NodeID>(moduleID))) {
+        processor->setMemoryArena(&arena);
+        processor->setRandomSeed(moduleID.value);
+        
+        if (auto node = addNode(std::move(processor), std::make_optional<NodeID>(moduleID), UpdateKind::none)) {
             // When we detect an output module, we hook it up to the main output node
             if (isOutput)
                 connectToOuput(node);
+            
+            topologyChanged();
         } else {
             state.deleteModule(moduleID);
         }
@@ -55,6 +67,7 @@ AudioEngine::AudioEngine(State& state) : state(state)
     };
     
     state.addListener(this);
+    retiredPlansCollector.startTimer(500);
 }
 
 AudioEngine::~AudioEngine()
@@ -62,23 +75,283 @@ AudioEngine::~AudioEngine()
     deviceManager.removeAudioCallback(&player);
     player.setProcessor(nullptr);
     state.removeListener(this);
+    asyncRebuild.cancelPendingUpdate();
+    retiredPlansCollector.stopTimer();
+    
+    // The audio thread is gone, every plan can be freed from here
+    freeRetiredPlans();
+    delete pendingPlan.exchange(nullptr);
+    delete std::exchange(activePlan, nullptr);
+    
+    // The modules give their memory back to the arena, it must still be around
+    clear(UpdateKind::none);
+}
+
+void AudioEngine::prepareToPlay(double sampleRate, int maximumBlockSize)
+{
+    {
+        const juce::ScopedLock lock (planLock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = maximumBlockSize;
+        modulesAreStale = true;
+        
+        // Modules get prepared again with the new settings, the audio thread mustn't run them meanwhile
+        detachRenderPlan();
+    }
+    
+    if (juce::MessageManager::getInstance()->isThisTheMessageThread())
+        rebuildRenderPlan();
+    else
+        asyncRebuild.triggerAsyncUpdate();
+}
+
+void AudioEngine::releaseResources()
+{
+    const juce::ScopedLock lock (planLock);
+    preparedBlockSize = 0;
+    publishRenderPlan(std::make_unique<RenderPlan>());
+}
+
+void AudioEngine::processBlock (juce::AudioBuffer<float>& audio, juce::MidiBuffer&)
+{
+    // Assure flush-to-zero
+    juce::ScopedNoDenormals nodenormals;
+    
+    // Odd from here on, until the block is done
+    audioThreadEpoch.fetch_add(1);
+    
+    adoptPendingPlan();
+    
+    if (activePlan == nullptr || activePlan->isEmpty()) {
+        audio.clear();
+    } else {
+        // Devices may deliver more than they announced, split those blocks (feedback loops may ask for shorter ones)
+        const int maxBlockSize = activePlan->hasFeedback() ? activePlan->getFeedbackDelay() : activePlan->getMaxBlockSize();
+        
+        for (int start = 0; start < audio.getNumSamples(); start += maxBlockSize) {
+            const int numSamples = std::min(maxBlockSize, audio.getNumSamples() - start);
+            
+            executor.process(*activePlan, numSamples);
+            activePlan->writeOutput(audio, start, numSamples);
+            activePlan->advanceDelays(numSamples);
+        }
+    }
+    
+    audioThreadEpoch.fetch_add(1);
+}
+
+void AudioEngine::adoptPendingPlan() noexcept
+{
+    // The plan we replace must fit in the queue, when it doesn't we keep the current plan for now
+    if (retiredPlansFifo.getFreeSpace() == 0)
+        return;
+    
+    auto* plan = pendingPlan.exchange(nullptr);
+    
+    if (plan == nullptr)
+        return;
+    
+    if (activePlan != nullptr) {
+        plan->inheritState(*activePlan);
+        
+        int start1, size1, start2, size2;
+        retiredPlansFifo.prepareToWrite(1, start1, size1, start2, size2);
+        retiredPlans[(size_t)(size1 > 0 ? start1 : start2)] = activePlan;
+        retiredPlansFifo.finishedWrite(1);
+    }
+    
+    activePlan = plan;
+}
+
+void AudioEngine::publishRenderPlan(std::unique_ptr<RenderPlan> plan)
+{
+    // A plan the audio thread never got to is still ours to delete
+    std::unique_ptr<RenderPlan> skippedPlan (pendingPlan.exchange(plan.release()));
+    
+    freeRetiredPlans();
+}
+
+void AudioEngine::detachRenderPlan()
+{
+    publishRenderPlan(std::make_unique<RenderPlan>());
+    waitForAudioThread();
+}
+
+void AudioEngine::waitForAudioThread() const
+{
+    const auto epoch = audioThreadEpoch.load();
+    
+    // Even: no block is running, the next one will adopt the pending plan before running anything
+    if (epoch % 2 == 0)
+        return;
+    
+    // Odd: a block is running, possibly with an old plan, wait until it's done (this takes one block at most)
+    while (audioThreadEpoch.load() == epoch)
+        std::this_thread::yield();
+}
+
+void AudioEngine::freeRetiredPlans()
+{
+    const juce::ScopedLock lock (planLock);
+    
+    const int numReady = retiredPlansFifo.getNumReady();
+    int start1, size1, start2, size2;
+    retiredPlansFifo.prepareToRead(numReady, start1, size1, start2, size2);
+    
+    for (int i = 0; i < size1; ++i)
+        delete retiredPlans[(size_t)(start1 + i)];
+    
+    for (int i = 0; i < size2; ++i)
+        delete retiredPlans[(size_t)(start2 + i)];
+    
+    retiredPlansFifo.finishedRead(size1 + size2);
+}
+
+void AudioEngine::rebuildRenderPlan()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    const juce::ScopedLock lock (planLock);
+    
+    const double sampleRate = preparedSampleRate;
+    const int blockSize = preparedBlockSize;
+    
+    // Nothing can be rendered until we get prepared
+    if (blockSize <= 0) return;
+    
+    // No module is running since prepareToPlay detached the plan, they can all be prepared again
+    const bool prepareAll = std::exchange(modulesAreStale, false);
+    
+    // Only new modules (or all of them, or the ones laid out again, after detaching the plan) can be out of date,
+    // so this never touches a module the audio thread is running.
+    // Modules move in and out of fused groups (loops and chains) without being prepared again, the plan picks how they run
+    for (auto* node : getNodes()) {
+        if (node == mainOutput.get()) continue;
+        
+        auto* processor = node->getProcessor();
+        
+        if (prepareAll || processor->getSampleRate() != sampleRate || processor->getBlockSize() != blockSize) {
+            processor->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            processor->prepareToPlay(sampleRate, blockSize);
+        }
+    }
+    
+    publishRenderPlan(std::make_unique<RenderPlan>(*this, mainOutput->nodeID, numOutputChannels, blockSize, executor.getMaxNumThreads(),
+                                                   feedbackConnections, feedbackBlockSize));
+}
+
+void AudioEngine::setFeedbackBlockSize(int numSamples)
+{
+    numSamples = std::max(0, numSamples);
+    
+    // The delays are part of the plan
+    if (std::exchange(feedbackBlockSize, numSamples) != numSamples)
+        topologyChanged();
+}
+
+void AudioEngine::topologyChanged()
+{
+    if (isInTransaction)
+        rebuildIsPending = true;
+    else
+        rebuildRenderPlan();
+}
+
+void AudioEngine::transactionBegan() {
+    isInTransaction = true;
+}
+
+void AudioEngine::transactionEnded() {
+    isInTransaction = false;
+    
+    if (std::exchange(rebuildIsPending, false))
+        rebuildRenderPlan();
 }
 
 void AudioEngine::moduleDeleted(ModuleID moduleID) {
-    removeNode((NodeID)moduleID);
+    removeNode((NodeID)moduleID, UpdateKind::none);
+    
+    std::erase_if(feedbackConnections, [&] (const Connection& connection) {
+        return connection.source.nodeID == (NodeID)moduleID || connection.destination.nodeID == (NodeID)moduleID;
+    });
+    
+    unloopFeedbackConnections();
+    topologyChanged();
 }
 
 void AudioEngine::connectionCreated(ConnectionID connectionID) {
-    if (!addConnection(connectionID))
+    if (addConnection(connectionID, UpdateKind::none))
+        topologyChanged();
+    else if (closesLoop(connectionID) && feedbackConnections.insert(connectionID).second)
+        topologyChanged();
+    else
         state.deleteConnection(connectionID);
 }
 
 void AudioEngine::connectionDeleted(ConnectionID connectionID) {
-    removeConnection(connectionID);
+    if (removeConnection(connectionID, UpdateKind::none)) {
+        unloopFeedbackConnections();
+        topologyChanged();
+    } else if (feedbackConnections.erase(connectionID) > 0) {
+        topologyChanged();
+    }
+}
+
+bool AudioEngine::closesLoop(const Connection& connection) const {
+    auto* source = getNodeForId(connection.source.nodeID);
+    auto* destination = getNodeForId(connection.destination.nodeID);
+    
+    if (source == nullptr || destination == nullptr)
+        return false;
+    
+    const bool portsExist = juce::isPositiveAndBelow(connection.source.channelIndex, source->getProcessor()->getTotalNumOutputChannels())
+                         && juce::isPositiveAndBelow(connection.destination.channelIndex, destination->getProcessor()->getTotalNumInputChannels());
+    
+    return portsExist && (source == destination || isAnInputTo(*destination, *source));
+}
+
+void AudioEngine::unloopFeedbackConnections() {
+    for (auto it = feedbackConnections.begin(); it != feedbackConnections.end();)
+        it = addConnection(*it, UpdateKind::none) ? feedbackConnections.erase(it) : std::next(it);
 }
 
 void AudioEngine::moduleEnabledChanged(ModuleID moduleID, bool isEnabled) {
+    // The flag only gets read while building plans, the audio thread picks it up with the next one
     getNodeForId((NodeID)moduleID)->getProcessor()->suspendProcessing(!isEnabled);
+    topologyChanged();
+}
+
+void AudioEngine::moduleVoicesChanged(ModuleID moduleID, int numVoices) {
+    auto* processor = getModule(moduleID);
+    
+    if (processor != nullptr && juce::jlimit(1, processor->getMaxNumVoices(), numVoices) != processor->getNumVoices())
+        reconfigureModule(*processor, [&] { processor->setNumVoices(numVoices); });
+}
+
+void AudioEngine::moduleOversamplingChanged(ModuleID moduleID, int factor) {
+    auto* processor = getModule(moduleID);
+    
+    if (processor != nullptr && juce::nextPowerOfTwo(juce::jlimit(1, processor->getMaxOversamplingFactor(), factor)) != processor->getOversamplingFactor())
+        reconfigureModule(*processor, [&] { processor->setOversamplingFactor(factor); });
+}
+
+ModuleProcessor* AudioEngine::getModule(ModuleID moduleID) const {
+    auto* node = getNodeForId((NodeID)moduleID);
+    return node != nullptr ? dynamic_cast<ModuleProcessor*>(node->getProcessor()) : nullptr;
+}
+
+void AudioEngine::reconfigureModule(ModuleProcessor& processor, const std::function<void()>& change) {
+    {
+        // The module lays out its state again, the audio thread mustn't run it meanwhile
+        const juce::ScopedLock lock (planLock);
+        detachRenderPlan();
+    }
+    
+    change();
+    
+    // Out of date settings make the rebuild prepare it again
+    processor.setRateAndBufferSizeDetails(0.0, 0);
+    topologyChanged();
 }
 
 void AudioEngine::connectToOuput(Node::Ptr nodeToConnect)
@@ -86,7 +359,7 @@ void AudioEngine::connectToOuput(Node::Ptr nodeToConnect)
     int connectionNumber = nodeToConnect->getProcessor()->getTotalNumOutputChannels();
     
     for (int i = 0; i < connectionNumber; i++)
-        addConnection ({ {nodeToConnect->nodeID, i}, {mainOutput->nodeID, i} });
+        addConnection ({ {nodeToConnect->nodeID, i}, {mainOutput->nodeID, i} }, UpdateKind::none);
 }
 
 void AudioEngine::allModulesDeleted() {
@@ -94,11 +367,15 @@ void AudioEngine::allModulesDeleted() {
 }
 
 void AudioEngine::resetEngine() {
-    clear();
+    clear(UpdateKind::none);
+    feedbackConnections.clear();
     
     // Add the main output node to the graph
     mainOutput = addNode(
         std::make_unique<AudioGraphIOProcessor>(AudioGraphIOProcessor::audioOutputNode),
-        std::make_optional<NodeID>(1)
+        std::make_optional<NodeID>(1),
+        UpdateKind::none
     );
+    
+    topologyChanged();
 }
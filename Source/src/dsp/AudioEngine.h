@@ -11,13 +11,34 @@
 #pragma once
 
 #include "../State.h"
+#include "RenderPlan.h"
+#include "GraphExecutor.h"
 
 /// The class where each module's DSP routine gets implemented as nodes and patched together
 struct AudioEngine : juce::AudioProcessorGraph,
                      State::Listener
 {
-    AudioEngine(State& state);
+    /// How the engine is driven: by the default audio device, or manually by calling processBlock (e.g. offline rendering)
+    enum class Playback { Device, Offline };
+    
+    /// `numThreads` renders the graph on that many threads (see setNumThreads()), 0 takes one per physical core
+    explicit AudioEngine(State& state, Playback playback = Playback::Device, int numThreads = 0);
     ~AudioEngine();
+    
+    /// The number of channels delivered to the audio device (or to the offline render target)
+    static constexpr int numOutputChannels = 2;
+    
+    /** Sets how many threads render the graph (including the audio thread), 1 renders every module on the audio thread.
+        Call it from the message thread */
+    void setNumThreads(int numThreads) { executor.setNumThreads(numThreads); }
+    int getNumThreads() const { return executor.getNumThreads(); }
+    
+    /** Shortens the delays that close feedback loops, and the blocks of patches with them (0 keeps the device's block size).
+        Call it from the message thread */
+    void setFeedbackBlockSize(int numSamples);
+    
+    void prepareToPlay (double sampleRate, int maximumBlockSize) override;
+    void releaseResources() override;
 
 private:
     State& state;
@@ -31,6 +52,65 @@ private:
     /// A constant output node to plug output modules into
     Node::Ptr mainOutput;
     
+    /// Runs the render plan, spreading independent modules across threads
+    GraphExecutor executor;
+    
+    //==============================================================================
+    // Render plans are immutable once built. The message thread publishes them through pendingPlan,
+    // the audio thread adopts the latest one when a block starts and hands the one it replaced back through retiredPlans.
+    // The audio thread never locks, allocates or frees anything to switch plans.
+    
+    /// The plan the audio thread is running (null before the first one arrives), only the audio thread touches it
+    RenderPlan* activePlan = nullptr;
+    /// The newest plan that the audio thread hasn't adopted yet
+    std::atomic<RenderPlan*> pendingPlan { nullptr };
+    
+    /// The plans the audio thread is done with, waiting to be freed off the audio thread
+    static constexpr int maxNumRetiredPlans = 32;
+    juce::AbstractFifo retiredPlansFifo { maxNumRetiredPlans };
+    std::array<RenderPlan*, maxNumRetiredPlans> retiredPlans {};
+    
+    /// Odd while the audio thread is inside processBlock, see waitForAudioThread()
+    std::atomic<juce::uint32> audioThreadEpoch { 0 };
+    
+    /// Serialises everything that builds or publishes plans (the message thread and the device's prepareToPlay), the audio thread never takes it
+    juce::CriticalSection planLock;
+    
+    /// The settings from the last prepareToPlay (a block size of 0 means the engine isn't prepared)
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+    
+    /// Where every module's DSP memory comes from, modules give theirs back when they're prepared again or deleted
+    MemoryArena arena { 1 << 22 };
+    /// Set by prepareToPlay, the next rebuild prepares every module
+    bool modulesAreStale = false;
+    
+    /// The connections the graph refused because they close a loop, the render plan delays them by a block
+    std::set<Connection> feedbackConnections;
+    
+    int feedbackBlockSize = 0;
+    
+    /// Whether the graph refused this connection only because it would close a loop
+    bool closesLoop(const Connection&) const;
+    
+    /// Moves the feedback connections that don't close a loop anymore into the graph
+    void unloopFeedbackConnections();
+    
+    /// Hands a plan to the audio thread, it starts running it with the next block. Call with the planLock held
+    void publishRenderPlan(std::unique_ptr<RenderPlan>);
+    
+    /// Publishes an empty plan and returns once the audio thread can't be running any module. Call with the planLock held
+    void detachRenderPlan();
+    
+    /// Returns once the audio thread has left any block it might have started before this call
+    void waitForAudioThread() const;
+    
+    /// Called by the audio thread when a block starts
+    void adoptPendingPlan() noexcept;
+    
+    /// Deletes the plans the audio thread retired (and any removed module they were still holding on to)
+    void freeRetiredPlans();
+    
     /** Connects all the outlets of a node to the output node.
         This function should only be called on modules that are meant as an audio output to the patcher.
         Its use however, still allows for the outlets to be connected to other modules in the patcher, if they are made available */
@@ -38,15 +118,47 @@ private:
     
     void resetEngine();
     
+    /// The module with this ID, if there's one
+    ModuleProcessor* getModule(ModuleID) const;
+    
+    /// Detaches the plan, lets the change lay the module out again (e.g. its voices) and has the next rebuild prepare it
+    void reconfigureModule(ModuleProcessor&, const std::function<void()>& change);
+    
+    /** Prepares any module that isn't prepared yet and compiles a new render plan from the graph.
+        Must be called on the message thread after every change to the graph's nodes or connections (see topologyChanged).
+        The graph only stores the nodes and connections, its own render sequence is never used, so it's edited with UpdateKind::none */
+    void rebuildRenderPlan();
+    
+    /// Rebuilds the render plan now, or once the state's current transaction ends
+    void topologyChanged();
+    
+    /// Set while the state groups changes together, they all make it into a single render plan at the end
+    bool isInTransaction = false;
+    bool rebuildIsPending = false;
+    
+    /// Rebuilds the plan on the message thread when the device prepares us from another thread
+    struct AsyncRebuild : juce::AsyncUpdater {
+        AsyncRebuild(AudioEngine& engine) : engine(engine) {}
+        void handleAsyncUpdate() override { engine.rebuildRenderPlan(); }
+        AudioEngine& engine;
+    } asyncRebuild { *this };
+    
+    /// Regularly frees the retired plans, they're also freed whenever a new plan gets published
+    struct RetiredPlansCollector : juce::Timer {
+        RetiredPlansCollector(AudioEngine& engine) : engine(engine) {}
+        void timerCallback() override { engine.freeRetiredPlans(); }
+        AudioEngine& engine;
+    } retiredPlansCollector { *this };
+    
     void moduleDeleted(ModuleID) override;
     void connectionCreated(ConnectionID) override;
     void connectionDeleted(ConnectionID) override;
     void moduleEnabledChanged(ModuleID, bool) override;
+    void moduleVoicesChanged(ModuleID, int) override;
+    void moduleOversamplingChanged(ModuleID, int) override;
     void allModulesDeleted() override;
+    void transactionBegan() override;
+    void transactionEnded() override;
     
-    // Assure flush-to-zero
-    void processBlock (juce::AudioBuffer<float>&  audio, juce::MidiBuffer& midi) override {
-        juce::ScopedNoDenormals nodenormals;
-        juce::AudioProcessorGraph::processBlock (audio, midi);
-    }
+    void processBlock (juce::AudioBuffer<float>&  audio, juce::MidiBuffer& midi) override;
 };
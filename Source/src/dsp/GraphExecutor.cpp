@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    GraphExecutor.cpp
+    Created: 18 Oct 2026 5:02:44pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#include "GraphExecutor.h"
+
+GraphExecutor::GraphExecutor(int numThreads) :
+workers((size_t)std::max(0, juce::SystemStats::getNumCpus() - 1))
+{
+    setNumThreads(numThreads);
+}
+
+GraphExecutor::~GraphExecutor()
+{
+    for (auto& worker : workers)
+        if (worker != nullptr)
+            worker->signalThreadShouldExit();
+
+    for (auto& worker : workers) {
+        if (worker == nullptr) continue;
+        
+        if (worker->sleeping.exchange(false))
+            worker->wakeUp.release();
+
+        worker->stopThread(1000);
+    }
+}
+
+void GraphExecutor::setNumThreads(int numThreads)
+{
+    const int numWorkers = juce::jlimit(0, (int)workers.size(), numThreads - 1);
+    
+    // The audio thread only looks at workers below numActiveWorkers, the slots above it are free to fill
+    for (int i = 0; i < numWorkers; ++i) {
+        auto& worker = workers[(size_t)i];
+        
+        if (worker != nullptr) continue;
+        
+        // Queue 0 belongs to the audio thread
+        worker = std::make_unique<Worker>(*this, i + 1);
+        
+        if (!worker->startRealtimeThread(juce::Thread::RealtimeOptions{}))
+            worker->startThread(juce::Thread::Priority::highest);
+    }
+    
+    numActiveWorkers.store(numWorkers, std::memory_order_release);
+}
+
+void GraphExecutor::process(RenderPlan& planToRun, int blockSize)
+{
+    const int numWorkers = std::min(numActiveWorkers.load(std::memory_order_acquire), planToRun.numQueues - 1);
+    const int numSteps = (int)planToRun.steps.size();
+
+    // Nothing to gain from the workers, don't pay for waking them up
+    if (numWorkers <= 0 || !planToRun.isParallel()) {
+        for (int i = 0; i < numSteps; ++i)
+            planToRun.processStep(i, blockSize);
+
+        return;
+    }
+
+    plan = &planToRun;
+    numSamples = blockSize;
+    numQueues = numWorkers + 1;
+
+    for (int i = 0; i < numSteps; ++i)
+        plan->pendingDependencies[(size_t)i].store(plan->steps[(size_t)i].numDependencies, std::memory_order_relaxed);
+
+    for (int i = 0; i < numQueues; ++i)
+        plan->queues[(size_t)i].reset(0);
+
+    // Spread the roots across the threads, they'll steal from each other when this isn't even
+    for (size_t i = 0; i < plan->roots.size(); ++i)
+        plan->queues[i % (size_t)numQueues].push(plan->roots[i]);
+
+    remainingSteps.store(numSteps, std::memory_order_relaxed);
+    participants.store(blockIsOpen, std::memory_order_release);
+    generation.fetch_add(1);
+
+    for (int i = 0; i < numWorkers; ++i)
+        if (workers[(size_t)i]->sleeping.exchange(false))
+            workers[(size_t)i]->wakeUp.release();
+
+    participate(0);
+
+    // Close the block, workers that didn't make it in time won't join anymore
+    participants.fetch_and(~blockIsOpen, std::memory_order_acq_rel);
+
+    while (participants.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+}
+
+void GraphExecutor::participate(int queueIndex)
+{
+    auto* queues = plan->queues.get();
+    int step = 0;
+
+    while (remainingSteps.load(std::memory_order_acquire) > 0) {
+        if (queues[queueIndex].pop(step)) {
+            runStep(step, queueIndex);
+            continue;
+        }
+
+        bool stolen = false;
+
+        for (int i = 1; i < numQueues && !stolen; ++i)
+            stolen = queues[(queueIndex + i) % numQueues].steal(step);
+
+        if (stolen)
+            runStep(step, queueIndex);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void GraphExecutor::runStep(int step, int queueIndex)
+{
+    plan->processStep(step, numSamples);
+
+    // Whoever finishes the last dependency gets to run the dependent (its inlets are likely still in cache)
+    for (int dependent : plan->steps[(size_t)step].dependents)
+        if (plan->pendingDependencies[(size_t)dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+            plan->queues[(size_t)queueIndex].push(dependent);
+
+    remainingSteps.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+//==============================================================================
+GraphExecutor::Worker::Worker(GraphExecutor& owner, int queueIndex) :
+juce::Thread("Phi Graph Worker"),
+owner(owner),
+queueIndex(queueIndex)
+{}
+
+void GraphExecutor::Worker::run()
+{
+    juce::ScopedNoDenormals noDenormals;
+
+    while (!threadShouldExit()) {
+        if (owner.generation.load(std::memory_order_acquire) == lastGeneration) {
+            // Blocks usually come back to back, spin a little before going to sleep
+            for (int spin = 0; spin < 64 && owner.generation.load(std::memory_order_acquire) == lastGeneration; ++spin)
+                std::this_thread::yield();
+
+            if (owner.generation.load(std::memory_order_acquire) == lastGeneration) {
+                sleeping.store(true);
+
+                if (owner.generation.load() == lastGeneration && !threadShouldExit())
+                    wakeUp.acquire();
+                else if (!sleeping.exchange(false))
+                    wakeUp.acquire(); // We've already been woken up, consume it
+            }
+
+            continue;
+        }
+
+        lastGeneration = owner.generation.load(std::memory_order_acquire);
+
+        // Join the block, unless it's already over
+        int current = owner.participants.load(std::memory_order_relaxed);
+        bool joined = false;
+
+        while ((current & blockIsOpen) != 0 && !joined)
+            joined = owner.participants.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed);
+
+        if (!joined) continue;
+
+        if (queueIndex < owner.numQueues)
+            owner.participate(queueIndex);
+
+        owner.participants.fetch_sub(1, std::memory_order_release);
+    }
+}
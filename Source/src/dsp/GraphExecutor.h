@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    GraphExecutor.h
+    Created: 18 Oct 2026 5:02:44pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <semaphore>
+#include "RenderPlan.h"
+
+/**
+ Runs a RenderPlan on the calling (audio) thread plus a pool of real-time worker threads.
+ Steps whose dependencies are done get pushed to the queue of the thread that finished them,
+ idle threads steal from the others. All threads meet once per block, when the last step is done.
+ */
+struct GraphExecutor
+{
+    /// Starts `numThreads - 1` workers (the audio thread is always the first), at most one per spare CPU
+    explicit GraphExecutor(int numThreads);
+    ~GraphExecutor();
+
+    /** The total number of threads processing each block (including the audio thread).
+        Call it from the message thread, it starts the workers that weren't needed so far (they're never stopped, only left asleep) */
+    void setNumThreads(int);
+    int getNumThreads() const { return numActiveWorkers.load() + 1; }
+
+    /// The most threads a plan can ever be run on, plans must be built with this many queues
+    int getMaxNumThreads() const { return (int)workers.size() + 1; }
+
+    /// Processes every step of the plan, returns when they're all done. Call from the audio thread only!
+    void process(RenderPlan&, int numSamples);
+
+private:
+    struct Worker : juce::Thread {
+        Worker(GraphExecutor& owner, int queueIndex);
+        void run() override;
+
+        GraphExecutor& owner;
+        const int queueIndex;
+
+        std::atomic<bool> sleeping {false};
+        std::counting_semaphore<> wakeUp {0};
+        juce::uint32 lastGeneration = 0;
+    };
+
+    /// One slot per spare CPU, filled as workers get started. numActiveWorkers only counts started ones
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<int> numActiveWorkers {0};
+
+    //==============================================================================
+    // The block being processed
+
+    /// Bumped to hand a new block to the workers
+    std::atomic<juce::uint32> generation {0};
+
+    /// The number of threads inside the block, the top bit is set while the block accepts new threads
+    std::atomic<int> participants {0};
+    static constexpr int blockIsOpen = 1 << 30;
+
+    std::atomic<int> remainingSteps {0};
+    RenderPlan* plan = nullptr;
+    int numSamples = 0, numQueues = 1;
+
+    /// Pops or steals steps until there are none left in this block
+    void participate(int queueIndex);
+    void runStep(int step, int queueIndex);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphExecutor)
+};
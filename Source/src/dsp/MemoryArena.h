@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    MemoryArena.h
+    Created: 18 Oct 2026 9:12:37pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ The allocator for the modules' DSP memory (delay lines and the like).
+ Memory is handed out in cache-line aligned pieces from big chunks, so the modules' state sits close together.
+ Every piece can be released on its own (a module gives its memory back when it's prepared again or deleted),
+ released pieces get handed out again before the chunks grow, neighbouring ones merge.
+ Never touch it from the audio thread, it locks.
+ */
+struct MemoryArena
+{
+    /// Every allocation starts on a new cache line
+    static constexpr size_t alignment = 64;
+
+    /// Reserves the first chunk up front
+    explicit MemoryArena(size_t chunkSize = 1 << 22) : chunkSize(chunkSize)
+    {
+        addChunk(chunkSize);
+    }
+
+    /// Returns uninitialised memory for `count` items, valid until it's released
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        static_assert (std::is_trivially_destructible_v<T>, "The arena never runs destructors");
+        static_assert (alignof(T) <= alignment);
+
+        return static_cast<T*>(allocateBytes(count * sizeof(T)));
+    }
+
+    void* allocateBytes(size_t numBytes)
+    {
+        const juce::ScopedLock lock (mutex);
+        
+        numBytes = roundSize(numBytes);
+
+        // The first released piece that fits, then whatever's left at the end of a chunk
+        for (auto& chunk : chunks) {
+            for (auto it = chunk.freePieces.begin(); it != chunk.freePieces.end(); ++it) {
+                auto [offset, size] = *it;
+                
+                if (size < numBytes) continue;
+                
+                chunk.freePieces.erase(it);
+                
+                if (size > numBytes)
+                    chunk.freePieces[offset + numBytes] = size - numBytes;
+                
+                return chunk.start + offset;
+            }
+        }
+        
+        for (auto& chunk : chunks) {
+            if (chunk.used + numBytes <= chunk.size) {
+                auto* memory = chunk.start + chunk.used;
+                chunk.used += numBytes;
+                return memory;
+            }
+        }
+
+        auto& chunk = addChunk(std::max(chunkSize, numBytes));
+        chunk.used = numBytes;
+        return chunk.start;
+    }
+    
+    /// Gives back memory from allocateBytes(), with the same size it was allocated with
+    void releaseBytes(void* memory, size_t numBytes)
+    {
+        const juce::ScopedLock lock (mutex);
+        
+        numBytes = roundSize(numBytes);
+        
+        auto* piece = static_cast<char*>(memory);
+        auto chunk = std::find_if(chunks.begin(), chunks.end(), [&] (const Chunk& chunk) {
+            return piece >= chunk.start && piece < chunk.start + chunk.used;
+        });
+        
+        jassert(chunk != chunks.end()); // <- Not from this arena!
+        if (chunk == chunks.end()) return;
+        
+        auto& freePieces = chunk->freePieces;
+        size_t offset = (size_t)(piece - chunk->start);
+        
+        // Merge with the free neighbours
+        if (auto next = freePieces.find(offset + numBytes); next != freePieces.end()) {
+            numBytes += next->second;
+            freePieces.erase(next);
+        }
+        
+        if (auto previous = freePieces.lower_bound(offset); previous != freePieces.begin()) {
+            --previous;
+            
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                numBytes += previous->second;
+                freePieces.erase(previous);
+            }
+        }
+        
+        // A piece at the end goes back to the unused space
+        if (offset + numBytes == chunk->used)
+            chunk->used = offset;
+        else
+            freePieces[offset] = numBytes;
+    }
+
+    /// The bytes handed out and not released
+    size_t getNumBytesUsed() const noexcept
+    {
+        const juce::ScopedLock lock (mutex);
+        
+        size_t total = 0;
+
+        for (auto& chunk : chunks) {
+            total += chunk.used;
+            
+            for (auto& [offset, size] : chunk.freePieces)
+                total -= size;
+        }
+
+        return total;
+    }
+
+private:
+    struct Chunk {
+        juce::HeapBlock<char> memory;
+        char* start;
+        size_t size, used = 0;
+        /// Released pieces below `used`, by offset
+        std::map<size_t, size_t> freePieces;
+    };
+
+    const size_t chunkSize;
+    std::vector<Chunk> chunks;
+    juce::CriticalSection mutex;
+    
+    static size_t roundSize(size_t numBytes) noexcept
+    {
+        return (std::max<size_t>(numBytes, 1) + alignment - 1) & ~(alignment - 1);
+    }
+
+    Chunk& addChunk(size_t size)
+    {
+        juce::HeapBlock<char> memory (size + alignment);
+
+        // Align the start to a cache line
+        auto* start = memory.get() + ((alignment - (reinterpret_cast<uintptr_t>(memory.get()) & (alignment - 1))) & (alignment - 1));
+
+        chunks.push_back({ std::move(memory), start, size });
+        return chunks.back();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MemoryArena)
+};
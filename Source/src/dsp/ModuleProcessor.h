@@ -11,6 +11,7 @@
 #pragma once
 
 #include "Utils.h"
+#include "MemoryArena.h"
 
 struct ModuleUI;
 
@@ -40,11 +41,125 @@ struct FloatParameter : juce::AudioParameterFloat {
     {}
 };
 
+class ModuleProcessor;
+
+/**
+ Smooths a parameter into a per-sample ramp, rendered once per block before process().
+ Declare it as a member of the module, set its target from parameterChanged() and read getSamples() in process().
+ Once the ramp is over, blocks cost nothing until the target moves again.
+ @code
+ ParameterSmoother gain { *this, ParameterSmoother::Exponential };
+ 
+ void parameterChanged (int parameterIndex, float value) override {
+     if ((Param)parameterIndex == Param::gain) gain.setTarget(db_to_a(value));
+ }
+ @endcode
+*/
+struct ParameterSmoother
+{
+    enum Shape {
+        /// Moves by a constant step
+        Linear,
+        /// Moves by a constant ratio (perceptually even for frequencies and gains), values must not cross or touch 0
+        Exponential
+    };
+    
+    ParameterSmoother(ModuleProcessor& owner, Shape shape, double rampSeconds = 0.02);
+    
+    /// Where to ramp to, from parameterChanged(). The first target after prepare() is jumped to
+    void setTarget (float newTarget) noexcept { target = newTarget; }
+    
+    /// Whether every sample of this block is getValue()
+    bool isSteady() const noexcept { return remainingSamples == 0 && !moved; }
+    
+    /// The value at the end of this block
+    float getValue() const noexcept { return current; }
+    
+    /// This block's ramp, one value per sample
+    const float* getSamples() const noexcept { return samples.data(); }
+    
+private:
+    friend class ModuleProcessor;
+    
+    const Shape shape;
+    const double rampSeconds;
+    
+    std::vector<float> samples;
+    int rampLength = 1;
+    
+    float target = 0.0f, rampTarget = 0.0f, current = 0.0f, step = 0.0f;
+    int remainingSamples = 0;
+    bool logarithmic = false, moved = false, isFilled = false;
+    
+    void prepare (double sampleRate, int maxBlockSize)
+    {
+        samples.assign((size_t)std::max(1, maxBlockSize), target);
+        rampLength = std::max(1, juce::roundToInt(rampSeconds * sampleRate));
+        current = rampTarget = target;
+        remainingSamples = 0;
+        moved = false;
+        isFilled = true;
+    }
+    
+    void render (int numSamples) noexcept
+    {
+        moved = false;
+        
+        // A new target (re)starts the ramp from wherever we are
+        if (target != rampTarget) {
+            rampTarget = target;
+            
+            // Exponential ramps step in log2, so every sample can be computed on its own
+            logarithmic = shape == Exponential && current * target > 0.0f;
+            step = logarithmic ? fastmath::log2(target / current) / (float)rampLength
+                               : (target - current) / (float)rampLength;
+            remainingSamples = rampLength;
+        }
+        
+        if (remainingSamples == 0) {
+            // Steady, the buffer only needs filling once
+            if (!isFilled) {
+                std::fill(samples.begin(), samples.end(), current);
+                isFilled = true;
+            }
+            
+            return;
+        }
+        
+        jassert(numSamples <= (int)samples.size());
+        
+        const int numRampSamples = std::min(numSamples, remainingSamples);
+        const float start = current;
+        float* data = samples.data();
+        
+        // Flat loops, so the compiler vectorises them
+        if (logarithmic)
+            for (int n = 0; n < numRampSamples; ++n)
+                data[n] = start * fastmath::exp2(step * (float)(n + 1));
+        else
+            for (int n = 0; n < numRampSamples; ++n)
+                data[n] = start + step * (float)(n + 1);
+        
+        remainingSamples -= numRampSamples;
+        
+        if (remainingSamples == 0) {
+            // Land exactly on the target, whatever the rounding along the way
+            current = rampTarget;
+            std::fill(data + numRampSamples - 1, data + numSamples, current);
+        } else {
+            current = data[numRampSamples - 1];
+        }
+        
+        isFilled = false;
+        moved = true;
+    }
+};
+
 /**
  The base class for all modules' DSP implementation
 */
 class ModuleProcessor    : public juce::AudioProcessor,
-                           public juce::AudioProcessorValueTreeState::Listener
+                           private juce::AudioProcessorParameter::Listener
 {
 public:
     using Parameters = juce::AudioProcessorValueTreeState::ParameterLayout;
@@ -54,13 +169,33 @@ public:
     /// Output modules must set this to true, they should still define the number of output channels but they won't be displayed in the UI
     bool isOutput = false;
     
+    /// The most voices any module can run, see getMaxNumVoices()
+    static constexpr int maxNumVoices = 16;
+    
+    /// Which inlets and outlets are patched to other modules (one bit per inlet/outlet, shared by all of its voices)
+    struct Connections {
+        juce::uint32 inlets = ~0u, outlets = ~0u;
+        
+        /** Inlets that only move slowly, in a straight line (within a small tolerance), from their first to their last sample in this block.
+            Values derived from them can be computed at both ends of the block and interpolated, see BlockRamp. Unconnected inlets are always control rate.
+            A polyphonic inlet is only control rate when every one of its voices is */
+        juce::uint32 controlRateInlets = 0;
+        
+        bool isInletConnected (int inlet) const noexcept { return (inlets >> inlet) & 1u; }
+        bool isOutletConnected (int outlet) const noexcept { return (outlets >> outlet) & 1u; }
+        bool isControlRate (int inlet) const noexcept { return (controlRateInlets >> inlet) & 1u; }
+    };
+    
     /**
      * Constructs a processor for a module
      * The third and any other following argument allows you to declare any parameters for this processor as parameter pack
      * @param inletNumber Number of inlets
      * @param outletNumber Number of outlets (in output modules, this number corresponds to the number of channels to connect to the audio output device)
-     * @param paramsToUse Parameter pack of std::unique_ptr<RangedAudioParameter> to initialize the processor parameter tree
+     * @param paramsToUse Parameter pack of std::unique_ptr<RangedAudioParameter> to initialize the processor parameter tree.
+     *                    Their order defines the parameter indices, modules usually name them with an enum in the same order
      @code
+     enum class Param { gain, freq };
+     
      MyModuleProcessor() :
      ModuleProcessor( 2, 2,
        std::make_unique<AudioParameterFloat> ("gain", "Gain", NormalisableRange<float> (0.0f, 1.0f), 1.0f),
@@ -75,29 +210,194 @@ public:
     {
         setPlayConfigDetails (inletNumber, outletNumber, getSampleRate(), getBlockSize());
         
-        // Add parameter listeners
-        for (int i = 0; i < params.state.getNumChildren(); i++){
-            auto paramID = params.state.getChild(i).getProperty("id").toString();
-            params.addParameterListener(paramID, this);
-            parameterChanged(paramID, *params.getRawParameterValue(paramID));
+        // Pending changes are flagged in a 64 bit mask
+        jassert(getParameters().size() <= 64);
+        
+        // Cache every parameter's value, in declaration order, so they're never looked up by ID again
+        for (auto* parameter : getParameters()) {
+            auto* ranged = static_cast<juce::RangedAudioParameter*>(parameter);
+            
+            parameterTable.push_back({ ranged, params.getRawParameterValue(ranged->paramID) });
+            parameter->addListener(this);
         }
+        
+        pendingValues = std::make_unique<std::atomic<float>[]>(parameterTable.size());
     }
     
-    virtual ~ModuleProcessor() = default;
+    virtual ~ModuleProcessor()
+    {
+        for (auto& entry : parameterTable)
+            entry.parameter->removeListener(this);
+        
+        releaseMemory();
+    }
     
     /// Creates the UI for this Module
     virtual std::unique_ptr<ModuleUI> createUI() = 0;
     
+    /** Override this for modules that matter without feeding the output (e.g. a meter or a recorder).
+        The engine only renders the modules that can be heard, sinks count as heard, along with everything feeding them */
+    virtual bool isSink() const { return false; }
+    
     /// Called before playback starts, to let the processor prepare itself.
     virtual void prepare (double newSampleRate, int maxBlockSize) = 0;
     
-    /// Renders the next block.
+    /** Renders the next block.
+        The buffer holds the ports (see getChannel()), and may have more channels after them that belong to other modules, leave those alone */
     virtual void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) = 0;
     
-    /// Override this to get notified of parameter changes
-    virtual void parameterChanged (const juce::String& parameterID, float newValue) override {}
+    /** Override this (and supportsSampleProcessing()) to let the module run one sample at a time, so the engine can close
+        tight feedback loops through it with a single sample of delay.
+        `ports` holds one sample per port and voice, laid out like the block's channels (see getChannel()): the inlets come in and the outlets go out.
+        `index` is the sample's position in the block, to read the smoothers' ramps at.
+        It must share its state with process(), the engine may switch between them from one block to the next without preparing the module again */
+    virtual void processSample (float* ports, int index) {}
+    
+    /// Whether processSample() can run the module with its current number of voices
+    virtual bool supportsSampleProcessing() const { return false; }
+    
+    /// Whether the engine may run the module sample by sample, it only does while the module doesn't oversample
+    bool canProcessSamples() const { return supportsSampleProcessing() && oversamplingFactor == 1; }
+    
+    /** Called by the engine instead of processBlock() when it runs the module sample by sample: delivers the parameter changes
+        and renders the smoothers for the whole block, processSample() then gets called for each of its samples */
+    void beginSampleBlock (int numSamples) noexcept
+    {
+        deliverParameterChanges();
+        
+        for (auto* smoother : smoothers)
+            smoother->render(numSamples);
+    }
+    
+    /** Override this to get notified of parameter changes, by index (see the constructor).
+        Changes are queued and delivered on the audio thread right before process(), and all parameters are delivered before prepare() */
+    virtual void parameterChanged (int parameterIndex, float newValue) {}
+    
+    /// The current (denormalised) value of a parameter, safe to call from any thread
+    template <typename Index>
+    float getParameterValue (Index index) const noexcept { return parameterTable[(size_t)index].value->load(std::memory_order_relaxed); }
+    
+    /// The atomic behind a parameter's value, writing to it bypasses parameterChanged()
+    template <typename Index>
+    std::atomic<float>& getRawParameter (Index index) const noexcept { return *parameterTable[(size_t)index].value; }
+    
+    /** Set by the engine before every block, on the audio thread.
+        Unconnected inlets are always silent and unconnected outlets are discarded, so process() may skip any work on them.
+        When not driven by the engine (e.g. in the benchmark) everything counts as connected */
+    void setConnections (Connections newConnections) noexcept { connections = newConnections; }
+    const Connections& getConnections() const noexcept { return connections; }
+    
+    /** Override this to let the module run more than one voice (up to maxNumVoices).
+        Polyphonic modules must keep separate state per voice and find each voice's samples with getChannel() */
+    virtual int getMaxNumVoices() const { return 1; }
+    
+    /** Set by the engine, never while the module is being processed, and prepare() is always called again before the next block.
+        Connections carry all of the voices: a mono outlet is copied to every voice of a polyphonic inlet, a polyphonic outlet is mixed down into a mono inlet */
+    void setNumVoices (int newNumVoices) noexcept { numVoices = juce::jlimit(1, getMaxNumVoices(), newNumVoices); }
+    int getNumVoices() const noexcept { return numVoices; }
+    
+    /// The buffer channel holding one voice of an inlet or outlet, every port spans getNumVoices() consecutive channels
+    int getChannel (int port, int voice) const noexcept { return port * numVoices + voice; }
+    
+    /** Override this to let the module run at 2, 4 or 8 times the sample rate, for nonlinearities that would alias otherwise.
+        The user picks the factor per module (see setOversamplingFactor()), it's off by default */
+    virtual int getMaxOversamplingFactor() const { return 1; }
+    
+    /** Set by the engine, never while the module is being processed, and prepare() is always called again before the next block.
+        Every channel is upsampled before process() and downsampled after it through polyphase half-band filters,
+        prepare() and the smoothers get the oversampled rate and block size. Only the modules it's turned on for pay for it */
+    void setOversamplingFactor (int newFactor) noexcept
+    {
+        oversamplingFactor = juce::nextPowerOfTwo(juce::jlimit(1, getMaxOversamplingFactor(), newFactor));
+    }
+    int getOversamplingFactor() const noexcept { return oversamplingFactor; }
+    
+    /// Set by the engine before the module gets prepared, it must outlive the module (the module gives its memory back when it's deleted)
+    void setMemoryArena (MemoryArena* newArena) noexcept { arena = newArena; }
+    
+    /// Set by the engine (from the module's ID) before the module gets prepared, so the same patch always makes the same noise
+    void setRandomSeed (juce::uint64 newSeed) noexcept { randomSeed = newSeed; }
+    
+protected:
+    /// Modules seed their BlockRandoms with this in prepare(), so every render starts from the same sequence
+    juce::uint64 getRandomSeed() const noexcept { return randomSeed; }
+    
+    /** Uninitialised memory for the module's DSP state (e.g. delay lines), call it from prepare() only.
+        It's valid until the next prepare() (when it's given back), and comes from the engine's arena (or the module's own, when it runs outside of an engine) */
+    template <typename T>
+    T* allocate (size_t count)
+    {
+        if (arena == nullptr && ownArena == nullptr)
+            ownArena = std::make_unique<MemoryArena>(1 << 16);
+        
+        auto* memory = getArena().allocate<T>(count);
+        allocations.push_back({ memory, count * sizeof(T) });
+        return memory;
+    }
     
 private:
+    MemoryArena* arena = nullptr;
+    /// Everything allocate() handed out since the last prepare()
+    std::vector<std::pair<void*, size_t>> allocations;
+    juce::uint64 randomSeed = 0;
+    
+    /// Only set up when getOversamplingFactor() is above 1
+    std::unique_ptr<juce::dsp::Oversampling<float>> oversampling;
+    juce::AudioBuffer<float> oversampledBuffer;
+    std::unique_ptr<MemoryArena> ownArena;
+
+    Connections connections;
+    int numVoices = 1, oversamplingFactor = 1;
+    
+    MemoryArena& getArena() const noexcept { return arena != nullptr ? *arena : *ownArena; }
+    
+    void releaseMemory()
+    {
+        for (auto [memory, numBytes] : allocations)
+            getArena().releaseBytes(memory, numBytes);
+        
+        allocations.clear();
+    }
+    
+    struct ParameterEntry {
+        juce::RangedAudioParameter* parameter;
+        std::atomic<float>* value;
+    };
+    
+    /// Indexed in declaration order
+    std::vector<ParameterEntry> parameterTable;
+    
+    /// Registered by the module's ParameterSmoother members
+    std::vector<ParameterSmoother*> smoothers;
+    friend struct ParameterSmoother;
+    
+    /** The lock-free queue of parameter changes, from any thread to the audio thread.
+        A change sets its parameter's bit and value, so a burst of changes to one parameter costs the audio thread a single call */
+    std::atomic<juce::uint64> pendingChanges {0};
+    std::unique_ptr<std::atomic<float>[]> pendingValues;
+    
+    void parameterValueChanged (int parameterIndex, float newNormalisedValue) override
+    {
+        auto* parameter = parameterTable[(size_t)parameterIndex].parameter;
+        
+        pendingValues[(size_t)parameterIndex].store(parameter->convertFrom0to1(newNormalisedValue), std::memory_order_relaxed);
+        pendingChanges.fetch_or(juce::uint64(1) << parameterIndex, std::memory_order_release);
+    }
+    
+    void parameterGestureChanged (int, bool) override {}
+    
+    void deliverParameterChanges() noexcept
+    {
+        auto changes = pendingChanges.exchange(0, std::memory_order_acquire);
+        
+        while (changes != 0) {
+            const int index = std::countr_zero(changes);
+            changes &= changes - 1;
+            
+            parameterChanged(index, pendingValues[(size_t)index].load(std::memory_order_relaxed));
+        }
+    }
+    
     
     ///@cond
     const juce::String getName() const override {return "";}
@@ -117,20 +417,89 @@ private:
     
     void prepareToPlay (double newSampleRate, int maxBlockSize) override
     {
-        // Initialise parameters
-        for (int i = 0; i < params.state.getNumChildren(); i++){
-            auto paramID = params.state.getChild(i).getProperty("id").toString();
-            parameterChanged(paramID, *params.getRawParameterValue(paramID));
-        }
+        // Initialise parameters, anything still queued is already part of their values
+        pendingChanges.store(0);
+        
+        for (size_t i = 0; i < parameterTable.size(); i++)
+            parameterChanged((int)i, parameterTable[i].value->load());
+        
+        // Nothing from the previous prepare() is in use anymore
+        releaseMemory();
+        
+        prepareOversampling(maxBlockSize);
+        
+        const int factor = getOversamplingFactor();
         
-        prepare(newSampleRate, maxBlockSize);
+        for (auto* smoother : smoothers)
+            smoother->prepare(newSampleRate * factor, maxBlockSize * factor);
+        
+        prepare(newSampleRate * factor, maxBlockSize * factor);
     }
     
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
     {
+        deliverParameterChanges();
+        
+        if (oversampling != nullptr) {
+            processOversampled(buffer, midiMessages);
+            return;
+        }
+        
+        for (auto* smoother : smoothers)
+            smoother->render(buffer.getNumSamples());
+        
         process(buffer, midiMessages);
     }
+    
+    void prepareOversampling (int maxBlockSize)
+    {
+        const int factor = getOversamplingFactor();
+        jassert(factor == 1 || factor == 2 || factor == 4 || factor == 8);
+        
+        if (factor <= 1) {
+            oversampling.reset();
+            oversampledBuffer.setSize(0, 0);
+            return;
+        }
+        
+        // Every port of every voice, like the buffers the engine hands us
+        const int numChannels = std::max({1, getTotalNumInputChannels(), getTotalNumOutputChannels()}) * numVoices;
+        
+        oversampling = std::make_unique<juce::dsp::Oversampling<float>>((size_t)numChannels,
+                                                                         (size_t)std::countr_zero((unsigned)factor),
+                                                                         juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+        oversampling->initProcessing((size_t)maxBlockSize);
+        oversampledBuffer.setSize(numChannels, maxBlockSize * factor);
+    }
+    
+    void processOversampled (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+    {
+        const int numChannels = std::min(buffer.getNumChannels(), oversampledBuffer.getNumChannels());
+        juce::dsp::AudioBlock<float> block (buffer.getArrayOfWritePointers(), (size_t)numChannels, (size_t)buffer.getNumSamples());
+        
+        // The oversampler keeps the upsampled block itself, process() gets a copy in a regular buffer
+        auto upsampled = oversampling->processSamplesUp(block);
+        const int numSamples = (int)upsampled.getNumSamples();
+        
+        oversampledBuffer.setSize(numChannels, numSamples, false, false, true);
+        juce::dsp::AudioBlock<float>(oversampledBuffer).copyFrom(upsampled);
+        
+        for (auto* smoother : smoothers)
+            smoother->render(numSamples);
+        
+        process(oversampledBuffer, midiMessages);
+        
+        upsampled.copyFrom(oversampledBuffer);
+        oversampling->processSamplesDown(block);
+    }
     ///@endcond
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModuleProcessor)
 };
+
+inline ParameterSmoother::ParameterSmoother(ModuleProcessor& owner, Shape shape, double rampSeconds) :
+shape(shape),
+rampSeconds(rampSeconds)
+{
+    owner.smoothers.push_back(this);
+}
@@ -0,0 +1,908 @@
+/*
+  ==============================================================================
+
+    RenderPlan.cpp
+    Created: 18 Oct 2026 4:31:09pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#include "RenderPlan.h"
+#include <numeric>
+
+RenderPlan::RenderPlan(const Graph& graph, Graph::NodeID outputNode, int numOutputChannels, int maxBlockSize, int numQueues,
+                       const std::set<Graph::Connection>& feedbackConnections, int feedbackBlockSize) :
+outputs((size_t)numOutputChannels),
+numQueues(numQueues),
+maxBlockSize(maxBlockSize),
+feedbackDelay(feedbackBlockSize > 0 ? std::min(feedbackBlockSize, maxBlockSize) : maxBlockSize)
+{
+    auto connections = graph.getConnections();
+
+    // ============ Nodes and edges =======================
+
+    std::vector<Graph::Node*> nodes;
+    std::unordered_map<juce::uint32, int> nodeIndices;
+    
+    const auto liveNodes = findLiveNodes(graph, outputNode, feedbackConnections);
+
+    for (auto* node : graph.getNodes()) {
+        if (node->nodeID == outputNode || !liveNodes.contains(node->nodeID.uid)) continue;
+
+        nodeIndices[node->nodeID.uid] = (int)nodes.size();
+        nodes.push_back(node);
+    }
+
+    std::set<std::pair<int, int>> edges;
+
+    for (auto& connection : connections) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+
+        if (source != nodeIndices.end() && destination != nodeIndices.end())
+            edges.insert({source->second, destination->second});
+    }
+    
+    // A feedback connection only closes a loop while the way back from its destination to its source is live.
+    // Once it isn't (e.g. it goes through a disabled module) the connection is a plain one, its destination runs after its source
+    std::vector<std::vector<int>> successors (nodes.size());
+    
+    for (auto [source, destination] : edges)
+        successors[(size_t)source].push_back(destination);
+    
+    for (auto& connection : feedbackConnections) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+        
+        if (source != nodeIndices.end() && destination != nodeIndices.end())
+            successors[(size_t)source->second].push_back(destination->second);
+    }
+    
+    auto reaches = [&] (int from, int to) {
+        std::vector<bool> visited (nodes.size(), false);
+        std::vector<int> pending { from };
+        
+        while (!pending.empty()) {
+            const int node = pending.back();
+            pending.pop_back();
+            
+            if (node == to) return true;
+            if (visited[(size_t)node]) continue;
+            
+            visited[(size_t)node] = true;
+            pending.insert(pending.end(), successors[(size_t)node].begin(), successors[(size_t)node].end());
+        }
+        
+        return false;
+    };
+    
+    std::set<Graph::Connection> delayedConnections;
+    
+    for (auto& connection : feedbackConnections) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+        if (source == nodeIndices.end() || destination == nodeIndices.end()) continue;
+        
+        if (reaches(destination->second, source->second)) {
+            delayedConnections.insert(connection);
+        } else {
+            connections.push_back(connection);
+            edges.insert({source->second, destination->second});
+        }
+    }
+
+    // ============ Fused groups =======================
+
+    // Every node of a fused group is represented by the group's first node (in the graph's order), the others run inside of it
+    std::vector<int> leaders (nodes.size());
+    std::iota(leaders.begin(), leaders.end(), 0);
+    
+    std::unordered_map<int, std::vector<int>> groups;
+    std::unordered_set<int> chains;
+    
+    for (auto& group : findFusedGroups(graph, outputNode, feedbackConnections)) {
+        std::vector<int> members;
+        
+        for (auto* node : group.nodes) {
+            // Part of a group can't be heard (e.g. behind a disabled module), the rest still runs fused.
+            // A chain must stay unbroken, only what comes after the silent part is left
+            if (!nodeIndices.contains(node->nodeID.uid)) {
+                if (group.isChain)
+                    members.clear();
+                
+                continue;
+            }
+            
+            members.push_back(nodeIndices.at(node->nodeID.uid));
+        }
+        
+        if (members.empty() || (group.isChain && members.size() < 2)) continue;
+        
+        std::set<std::pair<int, int>> groupEdges;
+        
+        for (auto [source, destination] : edges)
+            if (std::find(members.begin(), members.end(), source) != members.end()
+                && std::find(members.begin(), members.end(), destination) != members.end())
+                groupEdges.insert({source, destination});
+        
+        auto groupOrder = sortTopologically(members, groupEdges);
+        
+        for (int member : groupOrder)
+            leaders[(size_t)member] = groupOrder.front();
+        
+        if (group.isChain)
+            chains.insert(groupOrder.front());
+        
+        groups[groupOrder.front()] = std::move(groupOrder);
+    }
+    
+    // The graph with every fused group collapsed into its leader
+    std::vector<int> units;
+    std::set<std::pair<int, int>> unitEdges;
+    
+    for (int i = 0; i < (int)nodes.size(); ++i)
+        if (leaders[(size_t)i] == i)
+            units.push_back(i);
+    
+    for (auto [source, destination] : edges)
+        if (leaders[(size_t)source] != leaders[(size_t)destination])
+            unitEdges.insert({leaders[(size_t)source], leaders[(size_t)destination]});
+    
+    // The graph refuses cycles, so every node gets ordered (delayed feedback connections don't take part in the order),
+    // and a fused group's nodes follow its leader
+    std::vector<int> order;
+    order.reserve(nodes.size());
+    
+    for (int unit : sortTopologically(units, unitEdges)) {
+        if (auto group = groups.find(unit); group != groups.end())
+            order.insert(order.end(), group->second.begin(), group->second.end());
+        else
+            order.push_back(unit);
+    }
+    
+    jassert(order.size() == nodes.size());
+
+    // ============ Steps =======================
+
+    std::vector<int> stepIndices (nodes.size(), -1);
+    steps.reserve(order.size());
+
+    for (int nodeIndex : order) {
+        stepIndices[(size_t)nodeIndex] = (int)steps.size();
+
+        auto* node = nodes[(size_t)nodeIndex];
+        auto* processor = node->getProcessor();
+
+        const int numInlets = processor->getTotalNumInputChannels();
+        const int numPorts = std::max({1, numInlets, processor->getTotalNumOutputChannels()});
+
+        auto& step = steps.emplace_back();
+        step.node = node;
+        step.processor = processor;
+        step.module = dynamic_cast<ModuleProcessor*>(processor);
+        step.numVoices = step.module != nullptr ? step.module->getNumVoices() : 1;
+        step.numPorts = numPorts;
+        step.buffer.setSize(numPorts * step.numVoices, maxBlockSize);
+        step.inlets.resize((size_t)numInlets);
+        
+        if (leaders[(size_t)nodeIndex] != nodeIndex || groups.contains(nodeIndex)) {
+            step.fusionLeader = stepIndices[(size_t)leaders[(size_t)nodeIndex]];
+            step.isChain = chains.contains(leaders[(size_t)nodeIndex]);
+            
+            if (!step.isChain) {
+                step.frame.resize((size_t)step.buffer.getNumChannels());
+                step.latest.resize((size_t)step.buffer.getNumChannels());
+            }
+            
+            steps[(size_t)step.fusionLeader].fusedSteps.push_back((int)steps.size() - 1);
+        }
+    }
+    
+    stepsByNode.reserve(steps.size());
+    
+    for (size_t index = 0; index < steps.size(); ++index)
+        stepsByNode.emplace_back(steps[index].node->nodeID.uid, (int)index);
+    
+    std::sort(stepsByNode.begin(), stepsByNode.end());
+    
+    // A chain runs in the buffer of its last step (the one the rest of the plan reads), large enough for any of its steps
+    for (auto& step : steps) {
+        if (!step.isChain || step.fusedSteps.empty()) continue;
+        
+        int numChannels = 0;
+        
+        for (int index : step.fusedSteps) {
+            numChannels = std::max(numChannels, steps[(size_t)index].buffer.getNumChannels());
+            steps[(size_t)index].buffer.setSize(0, 0);
+        }
+        
+        steps[(size_t)step.fusedSteps.back()].buffer.setSize(numChannels, maxBlockSize);
+    }
+
+    for (auto& connection : connections) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        if (source == nodeIndices.end()) continue;
+
+        const Source from { stepIndices[(size_t)source->second], connection.source.channelIndex };
+        const int channel = connection.destination.channelIndex;
+        
+        // An outlet only counts as connected once something in the plan reads it
+        std::vector<Source>* readers = nullptr;
+
+        if (connection.destination.nodeID == outputNode) {
+            if (channel < numOutputChannels)
+                readers = &outputs[(size_t)channel];
+        } else if (auto destination = nodeIndices.find(connection.destination.nodeID.uid); destination != nodeIndices.end()) {
+            auto& inlets = steps[(size_t)stepIndices[(size_t)destination->second]].inlets;
+
+            if (channel < (int)inlets.size())
+                readers = &inlets[(size_t)channel];
+        }
+        
+        if (readers == nullptr) continue;
+        
+        readers->push_back(from);
+        steps[(size_t)from.step].connections.outlets |= 1u << from.outlet;
+    }
+    
+    // The end of a loop reads its start a feedback delay late (or a sample late, in a fused loop), so they never wait on each other
+    for (auto& connection : delayedConnections) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+        
+        const Source from { stepIndices[(size_t)source->second], connection.source.channelIndex, true };
+        auto& inlets = steps[(size_t)stepIndices[(size_t)destination->second]].inlets;
+        
+        if (connection.destination.channelIndex >= (int)inlets.size()) continue;
+        
+        inlets[(size_t)connection.destination.channelIndex].push_back(from);
+        
+        auto& fromStep = steps[(size_t)from.step];
+        fromStep.connections.outlets |= 1u << from.outlet;
+        
+        if (fromStep.fusionLeader < 0 || leaders[(size_t)source->second] != leaders[(size_t)destination->second]) {
+            fromStep.delayedOutlets |= 1u << from.outlet;
+            feedback = true;
+        }
+    }
+    
+    for (auto& step : steps) {
+        if (step.delayedOutlets != 0) {
+            step.delayed.setSize(step.buffer.getNumChannels(), 2 * feedbackDelay);
+            step.delayed.clear();
+        }
+    }
+    
+    for (auto& step : steps)
+        for (size_t inlet = 0; inlet < step.inlets.size(); ++inlet)
+            if (!step.inlets[inlet].empty())
+                step.connections.inlets |= 1u << inlet;
+    
+    for (auto& step : steps)
+        if (step.fusionLeader >= 0 && !step.isChain)
+            addTaps(step);
+    
+    // Fused steps only write their buffers when something outside of their group reads them (a chain's last step always does)
+    for (auto& step : steps)
+        if (step.fusionLeader >= 0)
+            step.isReadOutside = step.delayedOutlets != 0;
+    
+    for (auto& step : steps)
+        for (auto& sources : step.inlets)
+            for (auto& source : sources)
+                if (steps[(size_t)source.step].fusionLeader != step.fusionLeader)
+                    steps[(size_t)source.step].isReadOutside = true;
+    
+    for (auto& sources : outputs)
+        for (auto& source : sources)
+            steps[(size_t)source.step].isReadOutside = true;
+
+    for (auto [source, destination] : unitEdges) {
+        steps[(size_t)stepIndices[(size_t)source]].dependents.push_back(stepIndices[(size_t)destination]);
+        steps[(size_t)stepIndices[(size_t)destination]].numDependencies++;
+    }
+    
+    // The rest of a fused group is done once its leader is, they only wait on it to keep the order valid
+    for (int i = 0; i < (int)steps.size(); ++i) {
+        if (const int leader = steps[(size_t)i].fusionLeader; leader >= 0 && leader != i) {
+            steps[(size_t)leader].dependents.push_back(i);
+            steps[(size_t)i].numDependencies++;
+        }
+    }
+
+    // ============ Parallelism =======================
+
+    // Steps on the same level (longest path from a root) never depend on each other
+    std::vector<int> levels (steps.size(), 0);
+    std::vector<int> stepsPerLevel (steps.size() + 1, 0);
+
+    for (int i = 0; i < (int)steps.size(); ++i) {
+        auto& step = steps[(size_t)i];
+
+        if (step.numDependencies == 0)
+            roots.push_back(i);
+
+        // The rest of a fused group has no work of its own
+        const bool isFollower = step.fusionLeader >= 0 && step.fusionLeader != i;
+        
+        if (!isFollower && ++stepsPerLevel[(size_t)levels[(size_t)i]] > 1)
+            parallel = true;
+
+        for (int dependent : step.dependents)
+            levels[(size_t)dependent] = std::max(levels[(size_t)dependent], levels[(size_t)i] + 1);
+    }
+
+    // ============ Executor scratch =======================
+
+    pendingDependencies = std::make_unique<std::atomic<int>[]>(steps.size());
+    queues = std::make_unique<WorkQueue[]>((size_t)numQueues);
+
+    for (int i = 0; i < numQueues; ++i)
+        queues[(size_t)i].reset((int)steps.size());
+}
+
+void RenderPlan::processStep(int index, int numSamples)
+{
+    auto& step = steps[(size_t)index];
+    
+    if (step.fusionLeader >= 0) {
+        // The leader runs the whole group
+        if (step.fusionLeader == index && step.isChain)
+            processChain(step, numSamples);
+        else if (step.fusionLeader == index)
+            processFused(step, numSamples);
+        
+        return;
+    }
+    
+    auto& buffer = step.buffer;
+    buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+
+    gatherInlets(step, buffer, numSamples);
+    process(step, buffer, numSamples);
+    keepDelayedOutlets(step, numSamples);
+}
+
+void RenderPlan::gatherInlets(const Step& step, juce::AudioBuffer<float>& buffer, int numSamples) const
+{
+    const int numVoices = step.numVoices;
+    
+    for (int port = 0; port < step.numPorts; ++port) {
+        if (port < (int)step.inlets.size())
+            gather(buffer, port, numVoices, step.inlets[(size_t)port], 0, numSamples);
+        else
+            for (int voice = 0; voice < numVoices; ++voice)
+                buffer.clear(port * numVoices + voice, 0, numSamples);
+    }
+}
+
+void RenderPlan::processChain(const Step& leader, int numSamples)
+{
+    auto& buffer = steps[(size_t)leader.fusedSteps.back()].buffer;
+    buffer.setSize(buffer.getNumChannels(), numSamples, false, false, true);
+    
+    for (int index : leader.fusedSteps) {
+        auto& step = steps[(size_t)index];
+        
+        if (index == leader.fusedSteps.front()) {
+            gatherInlets(step, buffer, numSamples);
+        } else {
+            // Every connected inlet already holds the outlet of the previous step that feeds it (outlet i feeds inlet i),
+            // the rest starts silent, like gather() would leave it
+            for (int port = 0; port < step.numPorts; ++port)
+                if (port >= (int)step.inlets.size() || step.inlets[(size_t)port].empty())
+                    for (int voice = 0; voice < step.numVoices; ++voice)
+                        buffer.clear(port * step.numVoices + voice, 0, numSamples);
+        }
+        
+        process(step, buffer, numSamples);
+    }
+}
+
+void RenderPlan::processFused(const Step& leader, int numSamples)
+{
+    // Get every step of the group ready for the block, like processStep() does
+    for (int index : leader.fusedSteps) {
+        auto& step = steps[(size_t)index];
+        step.buffer.setSize(step.buffer.getNumChannels(), numSamples, false, false, true);
+        
+        for (auto& tap : step.taps) {
+            auto& from = steps[(size_t)tap.step];
+            
+            // Taps inside the group keep reading the source's latest sample, the others walk through a whole block
+            if (tap.isInternal) {
+                tap.samples = from.latest.data() + tap.fromChannel;
+            } else if (tap.isDelayed) {
+                readDelayed(step.delayedReads, tap.delayedRead, 0, from, tap.fromChannel, numSamples, false);
+                tap.samples = step.delayedReads.getReadPointer(tap.delayedRead);
+            } else {
+                tap.samples = from.buffer.getReadPointer(tap.fromChannel);
+            }
+            
+            tap.stride = tap.isInternal ? 0 : 1;
+        }
+        
+        // Inlets fed from outside of the group are known for the whole block, the ones fed from inside never count as control rate
+        auto connections = step.connections;
+        connections.controlRateInlets = ~connections.inlets;
+        
+        for (int inlet = 0; inlet < (int)step.inlets.size(); ++inlet) {
+            if (!connections.isInletConnected(inlet)) continue;
+            
+            const int firstChannel = inlet * step.numVoices, endChannel = firstChannel + step.numVoices;
+            bool allTapsAreControlRate = true;
+            
+            for (auto& tap : step.taps)
+                if (tap.channel >= firstChannel && tap.channel < endChannel)
+                    allTapsAreControlRate = allTapsAreControlRate && !tap.isInternal && isControlRate(tap.samples, numSamples);
+            
+            if (allTapsAreControlRate)
+                connections.controlRateInlets |= 1u << inlet;
+        }
+        
+        step.module->setConnections(connections);
+        step.module->beginSampleBlock(numSamples);
+    }
+    
+    for (int n = 0; n < numSamples; ++n) {
+        for (int index : leader.fusedSteps) {
+            auto& step = steps[(size_t)index];
+            float* frame = step.frame.data();
+            const size_t numChannels = step.frame.size();
+            
+            std::fill(frame, frame + numChannels, 0.0f);
+            
+            for (auto& tap : step.taps)
+                frame[tap.channel] += tap.samples[n * tap.stride];
+            
+            step.module->processSample(frame, n);
+            std::copy(frame, frame + numChannels, step.latest.data());
+            
+            if (step.isReadOutside) {
+                auto* const* channels = step.buffer.getArrayOfWritePointers();
+                
+                for (size_t channel = 0; channel < numChannels; ++channel)
+                    channels[channel][n] = frame[channel];
+            }
+        }
+    }
+    
+    for (int index : leader.fusedSteps)
+        keepDelayedOutlets(steps[(size_t)index], numSamples);
+}
+
+void RenderPlan::keepDelayedOutlets(Step& step, int numSamples) const
+{
+    const int numVoices = step.numVoices;
+    
+    if (step.delayedOutlets == 0) return;
+    
+    // Keep what goes back around a loop, wrapping around the circular buffer
+    const int length = step.delayed.getNumSamples();
+    const int numBeforeWrap = std::min(numSamples, length - delayPosition);
+    
+    for (int outlet = 0; outlet < step.buffer.getNumChannels() / numVoices; ++outlet) {
+        if (!(step.delayedOutlets & (1u << outlet))) continue;
+        
+        for (int voice = 0; voice < numVoices; ++voice) {
+            const int channel = outlet * numVoices + voice;
+            
+            step.delayed.copyFrom(channel, delayPosition, step.buffer, channel, 0, numBeforeWrap);
+            
+            if (numBeforeWrap < numSamples)
+                step.delayed.copyFrom(channel, 0, step.buffer, channel, numBeforeWrap, numSamples - numBeforeWrap);
+        }
+    }
+}
+
+void RenderPlan::readDelayed(juce::AudioBuffer<float>& destination, int channel, int startSample,
+                             const Step& from, int fromChannel, int numSamples, bool add) const
+{
+    // The buffer is two feedback delays long, so this stretch was written before this block started
+    const int length = from.delayed.getNumSamples();
+    const int readPosition = (delayPosition + feedbackDelay) % length;
+    const int numBeforeWrap = std::min(numSamples, length - readPosition);
+    
+    auto read = [&] (int destinationStart, int fromStart, int count) {
+        if (add)
+            destination.addFrom(channel, destinationStart, from.delayed, fromChannel, fromStart, count);
+        else
+            destination.copyFrom(channel, destinationStart, from.delayed, fromChannel, fromStart, count);
+    };
+    
+    read(startSample, readPosition, numBeforeWrap);
+    
+    if (numBeforeWrap < numSamples)
+        read(startSample + numBeforeWrap, 0, numSamples - numBeforeWrap);
+}
+
+void RenderPlan::inheritState(const RenderPlan& previous) noexcept
+{
+    // Both plans list their steps sorted by node, so the previous steps are found by walking along with this plan's
+    auto oldEntry = previous.stepsByNode.begin();
+    
+    for (auto [nodeID, index] : stepsByNode) {
+        auto& step = steps[(size_t)index];
+        if (step.delayedOutlets == 0 && step.latest.empty()) continue;
+        
+        while (oldEntry != previous.stepsByNode.end() && oldEntry->first < nodeID)
+            ++oldEntry;
+        
+        if (oldEntry == previous.stepsByNode.end() || oldEntry->first != nodeID) continue;
+        
+        auto& old = previous.steps[(size_t)oldEntry->second];
+        
+        // The same ports and voices, otherwise the module was laid out again
+        if (old.buffer.getNumChannels() != step.buffer.getNumChannels()) continue;
+        
+        const int numVoices = step.numVoices;
+        
+        // The previous block's samples, unless it ran fused and nothing outside of its group needed them
+        const bool bufferIsWritten = old.fusionLeader < 0 || old.isReadOutside;
+        const int numBufferSamples = bufferIsWritten ? old.buffer.getNumSamples() : 0;
+        
+        // The sample j samples back from now sits j samples behind the delay position, in either plan
+        for (int outlet = 0; outlet < step.buffer.getNumChannels() / numVoices; ++outlet) {
+            if (!(step.delayedOutlets & (1u << outlet))) continue;
+            
+            const bool wasDelayed = old.delayedOutlets & (1u << outlet);
+            const int length = step.delayed.getNumSamples(), oldLength = old.delayed.getNumSamples();
+            const int numInherited = std::min(feedbackDelay, wasDelayed ? oldLength : numBufferSamples);
+            
+            for (int voice = 0; voice < numVoices; ++voice) {
+                const int channel = outlet * numVoices + voice;
+                float* delayed = step.delayed.getWritePointer(channel);
+                
+                if (wasDelayed) {
+                    const float* oldDelayed = old.delayed.getReadPointer(channel);
+                    
+                    for (int j = 1; j <= numInherited; ++j)
+                        delayed[(delayPosition - j + length) % length] = oldDelayed[(previous.delayPosition - j + oldLength) % oldLength];
+                } else {
+                    const float* oldSamples = old.buffer.getReadPointer(channel);
+                    
+                    for (int j = 1; j <= numInherited; ++j)
+                        delayed[(delayPosition - j + length) % length] = oldSamples[numBufferSamples - j];
+                }
+            }
+        }
+        
+        if (!step.latest.empty()) {
+            if (old.latest.size() == step.latest.size())
+                std::copy(old.latest.begin(), old.latest.end(), step.latest.begin());
+            else if (numBufferSamples > 0)
+                for (size_t channel = 0; channel < step.latest.size(); ++channel)
+                    step.latest[channel] = old.buffer.getSample((int)channel, numBufferSamples - 1);
+        }
+    }
+}
+
+void RenderPlan::advanceDelays(int numSamples) noexcept
+{
+    jassert(!feedback || numSamples <= feedbackDelay); // <- Reads would overtake writes!
+    
+    if (feedback)
+        delayPosition = (delayPosition + numSamples) % (2 * feedbackDelay);
+}
+
+void RenderPlan::addTaps(Step& step)
+{
+    const int numVoices = step.numVoices;
+    int numDelayedReads = 0;
+    
+    for (int port = 0; port < (int)step.inlets.size(); ++port) {
+        for (auto& source : step.inlets[(size_t)port]) {
+            auto& from = steps[(size_t)source.step];
+            const bool isInternal = from.fusionLeader == step.fusionLeader;
+            
+            // The same voices gather() would mix
+            for (int voice = 0; voice < numVoices; ++voice) {
+                const int firstVoice = numVoices == 1 ? 0 : voice % from.numVoices;
+                const int endVoice = numVoices == 1 ? from.numVoices : firstVoice + 1;
+                
+                for (int fromVoice = firstVoice; fromVoice < endVoice; ++fromVoice) {
+                    auto& tap = step.taps.emplace_back(Tap { port * numVoices + voice, source.step, source.outlet * from.numVoices + fromVoice,
+                                                             isInternal, source.isDelayed && !isInternal });
+                    
+                    if (tap.isDelayed)
+                        tap.delayedRead = numDelayedReads++;
+                }
+            }
+        }
+    }
+    
+    step.delayedReads.setSize(numDelayedReads, maxBlockSize);
+}
+
+std::vector<int> RenderPlan::sortTopologically(const std::vector<int>& nodes, const std::set<std::pair<int, int>>& edges)
+{
+    // Kahn's algorithm, the edges must only link the given nodes
+    std::unordered_map<int, std::vector<int>> dependents;
+    std::unordered_map<int, int> inDegrees;
+    
+    for (auto [source, destination] : edges) {
+        dependents[source].push_back(destination);
+        inDegrees[destination]++;
+    }
+    
+    std::vector<int> order;
+    order.reserve(nodes.size());
+    
+    for (int node : nodes)
+        if (inDegrees[node] == 0)
+            order.push_back(node);
+    
+    for (size_t i = 0; i < order.size(); ++i)
+        for (int dependent : dependents[order[i]])
+            if (--inDegrees[dependent] == 0)
+                order.push_back(dependent);
+    
+    return order;
+}
+
+std::unordered_set<juce::uint32> RenderPlan::findLiveNodes(const Graph& graph, Graph::NodeID outputNode,
+                                                          const std::set<Graph::Connection>& feedbackConnections)
+{
+    std::unordered_map<juce::uint32, std::vector<juce::uint32>> predecessors;
+    
+    for (auto& connection : graph.getConnections())
+        predecessors[connection.destination.nodeID.uid].push_back(connection.source.nodeID.uid);
+    
+    for (auto& connection : feedbackConnections)
+        predecessors[connection.destination.nodeID.uid].push_back(connection.source.nodeID.uid);
+    
+    auto isEnabled = [&] (juce::uint32 uid) {
+        auto* node = graph.getNodeForId(Graph::NodeID(uid));
+        return node != nullptr && !node->getProcessor()->isSuspended();
+    };
+    
+    // Walk upstream from everything that gets heard
+    std::vector<juce::uint32> pending { outputNode.uid };
+    
+    for (auto* node : graph.getNodes())
+        if (auto* module = dynamic_cast<ModuleProcessor*>(node->getProcessor()); module != nullptr && module->isSink())
+            pending.push_back(node->nodeID.uid);
+    
+    std::unordered_set<juce::uint32> liveNodes;
+    
+    while (!pending.empty()) {
+        const auto uid = pending.back();
+        pending.pop_back();
+        
+        if (liveNodes.contains(uid) || !isEnabled(uid)) continue;
+        
+        liveNodes.insert(uid);
+        
+        if (auto found = predecessors.find(uid); found != predecessors.end())
+            pending.insert(pending.end(), found->second.begin(), found->second.end());
+    }
+    
+    return liveNodes;
+}
+
+std::vector<RenderPlan::FusedGroup> RenderPlan::findFusedGroups(const Graph& graph, Graph::NodeID outputNode,
+                                                                                const std::set<Graph::Connection>& feedbackConnections)
+{
+    std::vector<Graph::Node*> nodes;
+    std::unordered_map<juce::uint32, int> nodeIndices;
+    
+    for (auto* node : graph.getNodes()) {
+        if (node->nodeID == outputNode) continue;
+        
+        nodeIndices[node->nodeID.uid] = (int)nodes.size();
+        nodes.push_back(node);
+    }
+    
+    std::vector<std::vector<int>> successors (nodes.size());
+    
+    auto addEdge = [&] (const Graph::Connection& connection) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+        
+        if (source != nodeIndices.end() && destination != nodeIndices.end())
+            successors[(size_t)source->second].push_back(destination->second);
+    };
+    
+    for (auto& connection : graph.getConnections())
+        addEdge(connection);
+    
+    for (auto& connection : feedbackConnections)
+        addEdge(connection);
+    
+    // Who reaches whom, patches are small enough for a search from every node
+    std::vector<std::vector<bool>> reaches (nodes.size(), std::vector<bool>(nodes.size(), false));
+    
+    for (size_t start = 0; start < nodes.size(); ++start) {
+        std::vector<int> pending (successors[start]);
+        
+        while (!pending.empty()) {
+            const auto node = (size_t)pending.back();
+            pending.pop_back();
+            
+            if (reaches[start][node]) continue;
+            
+            reaches[start][node] = true;
+            pending.insert(pending.end(), successors[node].begin(), successors[node].end());
+        }
+    }
+    
+    // Loops: nodes that reach each other (only feedback connections close them)
+    std::vector<FusedGroup> groups;
+    std::vector<bool> isInLoop (nodes.size(), false);
+    
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (isInLoop[i] || !reaches[i][i]) continue;
+        
+        std::vector<Graph::Node*> loop;
+        bool isFusable = true;
+        
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            if (reaches[i][j] && reaches[j][i]) {
+                isInLoop[j] = true;
+                loop.push_back(nodes[j]);
+                
+                auto* module = dynamic_cast<ModuleProcessor*>(nodes[j]->getProcessor());
+                isFusable = isFusable && module != nullptr && module->canProcessSamples();
+            }
+        }
+        
+        if (isFusable)
+            groups.push_back({ std::move(loop), false });
+    }
+    
+    // Chains: each link is the only node its source feeds, and the only one feeding its destination,
+    // through outlets that feed the inlets with the same index (so both sit on the same channels of a shared buffer)
+    std::vector<std::set<int>> nodeSuccessors (nodes.size()), nodePredecessors (nodes.size());
+    std::vector<bool> feedsOutput (nodes.size(), false);
+    std::set<std::pair<int, int>> crossedLinks;
+    // Delay edges read and write the steps' own buffers, which chains don't keep
+    std::vector<bool> hasFeedback (nodes.size(), false);
+    
+    for (auto& connection : feedbackConnections)
+        for (auto uid : { connection.source.nodeID.uid, connection.destination.nodeID.uid })
+            if (auto node = nodeIndices.find(uid); node != nodeIndices.end())
+                hasFeedback[(size_t)node->second] = true;
+    
+    for (auto& connection : graph.getConnections()) {
+        auto source = nodeIndices.find(connection.source.nodeID.uid);
+        auto destination = nodeIndices.find(connection.destination.nodeID.uid);
+        
+        if (source == nodeIndices.end()) continue;
+        
+        if (destination == nodeIndices.end()) {
+            feedsOutput[(size_t)source->second] = true;
+        } else {
+            nodeSuccessors[(size_t)source->second].insert(destination->second);
+            nodePredecessors[(size_t)destination->second].insert(source->second);
+            
+            if (connection.source.channelIndex != connection.destination.channelIndex)
+                crossedLinks.insert({source->second, destination->second});
+        }
+    }
+    
+    auto getModule = [&] (int node) { return dynamic_cast<ModuleProcessor*>(nodes[(size_t)node]->getProcessor()); };
+    
+    auto isChainable = [&] (int node) {
+        return !isInLoop[(size_t)node] && !hasFeedback[(size_t)node] && getModule(node) != nullptr;
+    };
+    
+    // The node the chain goes on to (-1 when it ends here)
+    auto getNextLink = [&] (int node) {
+        if (!isChainable(node) || feedsOutput[(size_t)node] || nodeSuccessors[(size_t)node].size() != 1)
+            return -1;
+        
+        const int next = *nodeSuccessors[(size_t)node].begin();
+        
+        if (nodePredecessors[(size_t)next].size() != 1 || !isChainable(next) || crossedLinks.contains({node, next})
+            || getModule(next)->getNumVoices() != getModule(node)->getNumVoices())
+            return -1;
+        
+        return next;
+    };
+    
+    for (int node = 0; node < (int)nodes.size(); ++node) {
+        // Chains are followed from their first node
+        const auto& predecessors = nodePredecessors[(size_t)node];
+        
+        if (!isChainable(node) || (predecessors.size() == 1 && getNextLink(*predecessors.begin()) == node))
+            continue;
+        
+        std::vector<Graph::Node*> chain { nodes[(size_t)node] };
+        
+        for (int next = getNextLink(node); next >= 0; next = getNextLink(next))
+            chain.push_back(nodes[(size_t)next]);
+        
+        if (chain.size() > 1)
+            groups.push_back({ std::move(chain), true });
+    }
+    
+    return groups;
+}
+
+void RenderPlan::process(Step& step, juce::AudioBuffer<float>& buffer, int numSamples)
+{
+    const int numVoices = step.numVoices;
+    
+    if (step.module != nullptr) {
+        auto connections = step.connections;
+        connections.controlRateInlets = ~connections.inlets;
+        
+        for (int inlet = 0; inlet < (int)step.inlets.size(); ++inlet) {
+            if (!connections.isInletConnected(inlet)) continue;
+            
+            bool allVoicesAreControlRate = true;
+            
+            for (int voice = 0; voice < numVoices && allVoicesAreControlRate; ++voice)
+                allVoicesAreControlRate = isControlRate(buffer.getReadPointer(inlet * numVoices + voice), numSamples);
+            
+            if (allVoicesAreControlRate)
+                connections.controlRateInlets |= 1u << inlet;
+        }
+        
+        step.module->setConnections(connections);
+    }
+    
+    step.processor->processBlock(buffer, step.midi);
+}
+
+void RenderPlan::writeOutput(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) const
+{
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+        if (channel < (int)outputs.size())
+            gather(buffer, channel, 1, outputs[(size_t)channel], startSample, numSamples);
+        else
+            buffer.clear(channel, startSample, numSamples);
+    }
+}
+
+bool RenderPlan::isControlRate(const float* samples, int numSamples) noexcept
+{
+    if (numSamples < 2) return true;
+    
+    const float first = samples[0];
+    
+    // A steep line is still audio rate for whatever gets derived from it
+    if (std::abs(samples[numSamples - 1] - first) > maxControlRateSpan)
+        return false;
+    
+    const float slope = (samples[numSamples - 1] - first) / (float)(numSamples - 1);
+    
+    for (int n = 1; n < numSamples - 1; ++n)
+        if (std::abs(samples[n] - (first + slope * (float)n)) > controlRateTolerance)
+            return false;
+    
+    return true;
+}
+
+void RenderPlan::gather(juce::AudioBuffer<float>& destination, int port, int numVoices, const std::vector<Source>& sources, int startSample, int numSamples) const
+{
+    for (int voice = 0; voice < numVoices; ++voice) {
+        const int channel = port * numVoices + voice;
+        bool isEmpty = true;
+        
+        for (auto& source : sources) {
+            auto& from = steps[(size_t)source.step];
+            
+            // A mono destination takes every voice, a polyphonic one only its own
+            const int firstVoice = numVoices == 1 ? 0 : voice % from.numVoices;
+            const int endVoice = numVoices == 1 ? from.numVoices : firstVoice + 1;
+            
+            for (int fromVoice = firstVoice; fromVoice < endVoice; ++fromVoice) {
+                const int fromChannel = source.outlet * from.numVoices + fromVoice;
+                
+                if (source.isDelayed)
+                    readDelayed(destination, channel, startSample, from, fromChannel, numSamples, !isEmpty);
+                else if (isEmpty)
+                    destination.copyFrom(channel, startSample, from.buffer, fromChannel, 0, numSamples);
+                else
+                    destination.addFrom(channel, startSample, from.buffer, fromChannel, 0, numSamples);
+                
+                isEmpty = false;
+            }
+        }
+        
+        if (isEmpty)
+            destination.clear(channel, startSample, numSamples);
+    }
+}
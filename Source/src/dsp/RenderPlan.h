@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+    RenderPlan.h
+    Created: 18 Oct 2026 4:31:09pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ModuleProcessor.h"
+
+/**
+ A lock-free work-stealing deque of step indices (Chase-Lev, fixed capacity).
+ Only the owning thread may push() and pop(), any thread may steal().
+ */
+struct WorkQueue
+{
+    /// Must be called while no other thread is using the queue
+    void reset(int capacity)
+    {
+        if ((size_t)capacity > size) {
+            size = (size_t)juce::nextPowerOfTwo(capacity);
+            items = std::make_unique<std::atomic<int>[]>(size);
+        }
+
+        top.store(0, std::memory_order_relaxed);
+        bottom.store(0, std::memory_order_relaxed);
+    }
+
+    void push(int item) noexcept
+    {
+        const auto b = bottom.load(std::memory_order_relaxed);
+        items[(size_t)b & (size - 1)].store(item, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(int& item) noexcept
+    {
+        const auto b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        item = items[(size_t)b & (size - 1)].load(std::memory_order_relaxed);
+
+        if (t == b) {
+            // Last item, race against thieves for it
+            const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    bool steal(int& item) noexcept
+    {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) return false;
+
+        item = items[(size_t)t & (size - 1)].load(std::memory_order_relaxed);
+        return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<juce::int64> top {0}, bottom {0};
+    std::unique_ptr<std::atomic<int>[]> items;
+    size_t size = 0;
+};
+
+/**
+ The compiled form of the processor graph: every node becomes a step that owns its buffer,
+ knows where to gather its inlets from and which steps depend on it.
+ Steps are stored in topological order, so running them in sequence is always valid.
+ Graph connections link ports, a step's buffer holds each of its ports once per voice (see ModuleProcessor::getChannel).
+ */
+struct RenderPlan
+{
+    using Graph = juce::AudioProcessorGraph;
+
+    /** An outlet of a step, with all of its voices (they're in the step's buffer after it has processed).
+        Delayed sources close feedback loops, they read what the outlet held getFeedbackDelay() samples earlier */
+    struct Source { int step, outlet; bool isDelayed = false; };
+    
+    /// A single channel feeding a channel of a step that runs sample by sample
+    struct Tap {
+        int channel, step, fromChannel;
+        /// Internal taps come from the same fused group, they read the source's latest sample
+        bool isInternal, isDelayed;
+        /// The channel of delayedReads that delayed taps read from
+        int delayedRead = -1;
+        
+        /// Resolved when the block starts, the sample n is at samples[n * stride]
+        const float* samples = nullptr;
+        int stride = 1;
+    };
+
+    struct Step {
+        Graph::Node::Ptr node;
+        juce::AudioProcessor* processor;
+        /// The same processor, if it's a module
+        ModuleProcessor* module;
+        ModuleProcessor::Connections connections { 0, 0 };
+        /// Every port spans this many channels of the buffer
+        int numVoices = 1;
+        int numPorts = 0;
+        
+        /** The outlets that feed a loop back, they're kept in `delayed`, a circular buffer twice as long as the feedback delay.
+            Every block writes one stretch of it and its readers read the stretch a feedback delay behind, so they never meet */
+        juce::uint32 delayedOutlets = 0;
+        juce::AudioBuffer<float> delayed;
+        
+        /** In a fused group, the step that runs the group (-1 otherwise).
+            The leader holds the group's steps in their running order, itself first */
+        int fusionLeader = -1;
+        std::vector<int> fusedSteps;
+        /// Whether the group is a chain, run block by block in the buffer of its last step (the other steps have none)
+        bool isChain = false;
+        /// Where the inlets get gathered sample by sample, and what came out of the last one
+        std::vector<Tap> taps;
+        std::vector<float> frame, latest;
+        /// The delayed taps' samples for the block, read out of their sources' circular buffers
+        juce::AudioBuffer<float> delayedReads;
+        /// Whether anything outside of its fused group reads the step's buffer, the buffer is left alone otherwise
+        bool isReadOutside = true;
+
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+
+        /// Every inlet's sources, these get summed
+        std::vector<std::vector<Source>> inlets;
+        /// The steps that read from this step's outlets
+        std::vector<int> dependents;
+        /// The number of distinct steps this one reads from
+        int numDependencies = 0;
+    };
+
+    /**
+     * Compiles the graph's current topology, leaving out the nodes that can't be heard (see findLiveNodes()).
+     * @param outputNode The node whose inlets are the engine's output channels
+     * @param numQueues The number of threads that may run this plan at once
+     * @param feedbackConnections Connections the graph refuses because they close a loop, they become delay edges while their loop is live (plain edges otherwise)
+     * @param feedbackBlockSize The length of those delays, a loop's latency (0 makes it maxBlockSize)
+     */
+    RenderPlan(const Graph&, Graph::NodeID outputNode, int numOutputChannels, int maxBlockSize, int numQueues,
+               const std::set<Graph::Connection>& feedbackConnections = {}, int feedbackBlockSize = 0);
+    
+    /// An empty plan, it renders silence
+    RenderPlan() = default;
+    
+    bool isEmpty() const { return steps.empty(); }
+    
+    /** The nodes worth rendering: the ones with a path to the output node or to a sink module (see ModuleProcessor::isSink()).
+        Disabled modules output silence, so they're left out and they block the paths through them.
+        The others (unpatched modules, half-built patches, whatever only feeds a disabled module) are skipped, keeping their state until they're live again */
+    static std::unordered_set<juce::uint32> findLiveNodes(const Graph&, Graph::NodeID outputNode,
+                                                          const std::set<Graph::Connection>& feedbackConnections);
+    
+    struct FusedGroup {
+        std::vector<Graph::Node*> nodes;
+        bool isChain;
+    };
+    
+    /** The groups of modules that get fused into a single step:
+        - Loops, the strongly connected nodes (including feedback connections) whose modules can all run sample by sample (see ModuleProcessor::canProcessSamples()).
+          They're interleaved one sample at a time, so their feedback is a single sample of delay, other loops keep a block of delay.
+        - Chains of modules where each one only feeds the next, the next is only fed by it, and every outlet feeds the inlet with the same index.
+          They run one after the other over a single buffer, each module's process() leaving its outlets right where the next one's inlets are,
+          so the chain takes one task and no gathering in between */
+    static std::vector<FusedGroup> findFusedGroups(const Graph&, Graph::NodeID outputNode,
+                                                   const std::set<Graph::Connection>& feedbackConnections);
+
+    std::vector<Step> steps;
+    /// The sources for each of the engine's output channels
+    std::vector<std::vector<Source>> outputs;
+
+    /// The step indices with no dependencies
+    std::vector<int> roots;
+
+    /// Whether any two steps could ever run at the same time
+    bool isParallel() const { return parallel; }
+    
+    /// Whether any loop gets closed by a delay edge, blocks must then be getFeedbackDelay() samples long at most
+    bool hasFeedback() const { return feedback; }
+
+    int getMaxBlockSize() const { return maxBlockSize; }
+    
+    /// The latency of the loops closed by delay edges
+    int getFeedbackDelay() const { return feedbackDelay; }
+    
+    /// How far (in CV units) an inlet may stray from a straight line and still be considered control rate
+    static constexpr float controlRateTolerance = 1.0e-4f;
+    
+    /** How far (in CV units) a control rate inlet may move within a block. Coefficients are exponential in the CV (e.g. 5^cv),
+        interpolating them linearly is only close enough over short spans (5^cv is off by about 0.1% across this one) */
+    static constexpr float maxControlRateSpan = 0.05f;
+
+    /// Gathers a step's inlets, tells the module what's patched and runs its processor
+    void processStep(int index, int numSamples);
+
+    /// Sums the steps feeding the output node into the buffer
+    void writeOutput(juce::AudioBuffer<float>&, int startSample, int numSamples) const;
+    
+    /// Moves the delay edges on, once every step of the block is done
+    void advanceDelays(int numSamples) noexcept;
+    
+    /** Carries the feedback state (the delay edges and the fused groups' latest samples) over from the plan this one replaces,
+        matching steps by their node, so loops keep ringing through edits elsewhere in the patch.
+        Call it on the audio thread, right before running this plan for the first time, it doesn't allocate
+        and takes a single pass over both plans' steps */
+    void inheritState(const RenderPlan& previous) noexcept;
+
+    //==============================================================================
+    /// Scratch space for the GraphExecutor, only touched while the plan is being processed
+    std::unique_ptr<std::atomic<int>[]> pendingDependencies;
+    std::unique_ptr<WorkQueue[]> queues;
+    int numQueues = 0;
+
+private:
+    int maxBlockSize = 0;
+    int feedbackDelay = 0;
+    /// Where the delay edges write the next block, in their circular buffers
+    int delayPosition = 0;
+    bool parallel = false;
+    bool feedback = false;
+    
+    /// (node ID, step index) for every step, sorted by node ID so inheritState() matches two plans in one pass
+    std::vector<std::pair<juce::uint32, int>> stepsByNode;
+
+    /** Sums the sources into every voice of a destination port, voice by voice.
+        Mono sources are copied to every voice, and a mono destination mixes all the voices of its sources.
+        Between different voice counts, voices wrap around the smaller one */
+    void gather(juce::AudioBuffer<float>& destination, int port, int numVoices, const std::vector<Source>&, int startSample, int numSamples) const;
+    
+    /// Gathers the step's inlets into the buffer, its other ports start silent
+    void gatherInlets(const Step&, juce::AudioBuffer<float>&, int numSamples) const;
+    
+    /// Tells the module what's patched and runs its processor over the gathered inlets, in the given buffer
+    static void process(Step&, juce::AudioBuffer<float>&, int numSamples);
+    
+    /// Runs every step of a fused loop, one sample at a time
+    void processFused(const Step& leader, int numSamples);
+    
+    /// Runs every step of a fused chain, one block at a time, in the last step's buffer
+    void processChain(const Step& leader, int numSamples);
+    
+    /// Resolves the inlets of a fused group's step into single channel taps
+    void addTaps(Step&);
+    
+    /// Writes the delayed outlets into the step's circular buffer
+    void keepDelayedOutlets(Step&, int numSamples) const;
+    
+    /// Reads a block of a delayed outlet's channel, from where its circular buffer is a feedback delay behind
+    void readDelayed(juce::AudioBuffer<float>& destination, int channel, int startSample,
+                     const Step& from, int fromChannel, int numSamples, bool add) const;
+    
+    /// Orders the nodes so every edge goes forward, the edges must not form a cycle
+    static std::vector<int> sortTopologically(const std::vector<int>& nodes, const std::set<std::pair<int, int>>& edges);
+    
+    /// Whether the samples follow a line from the first to the last one, within controlRateTolerance, moving by maxControlRateSpan at most
+    static bool isControlRate(const float* samples, int numSamples) noexcept;
+};
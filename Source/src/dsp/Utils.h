@@ -11,6 +11,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <bit>
 
 
 /// A mathematically accurate and waaaay faster implementation of `fmod()`
@@ -69,23 +70,309 @@ inline T mix(T outputWhenInterp0, T outputWhenInterp1, T interp) noexcept {
     return outputWhenInterp1 * interp + outputWhenInterp0 * ( (T)1.0 - interp );
 };
 
-template <typename Type>
+/**
+ Branch-free approximations of the libm functions we use per sample.
+ They only use arithmetic, comparisons and bit casts, so loops calling them auto-vectorise (unlike std::pow, std::sin...)
+ The error bounds below are measured over the whole documented range by `Phi --fast-math`
+ */
+namespace fastmath
+{
+    /// Rounds towards negative infinity, valid for |x| < 2^31
+    inline float floor(float x) noexcept
+    {
+        // Kept in integers, float selects stop compilers from vectorising
+        const int truncated = (int)x;
+        return (float)(truncated - (int)((float)truncated > x));
+    }
+
+    /// Returns the fractional part of `x` [0, 1), valid for |x| < 2^31
+    inline float frac(float x) noexcept
+    {
+        return x - floor(x);
+    }
+
+    /// 2^x, relative error < 3e-7 for |x| < 126 (saturates to 2^-126 and 2^127 beyond that, valid for |x| < 2^31)
+    inline float exp2(float x) noexcept
+    {
+        // 2^x = 2^i * 2^f, with f in [-0.5, 0.5]
+        const int i = (int)floor(x + 0.5f);
+        const float f = x - (float)i;
+
+        // Chebyshev fit of 2^f
+        const float p = 1.0000000754f + f * (0.6931471880f + f * (0.2402210749f + f * (0.0555035711f + f * (0.0096760319f + f * 0.0013390863f))));
+
+        // Clamping is done on the integer exponent, float selects stop compilers from vectorising
+        const int exponent = std::min(std::max(i, -126), 127);
+        return p * std::bit_cast<float>((exponent + 127) << 23);
+    }
+
+    /// log2(x) for positive, normal x, absolute error < 4e-7 + 1e-7 * |log2(x)|
+    inline float log2(float x) noexcept
+    {
+        const auto bits = std::bit_cast<int>(x);
+
+        // x = m * 2^e, with m in [sqrt(0.5), sqrt(2))
+        const int offset = (bits - 0x3f3504f3) & ~0x7fffff;
+        const float e = (float)(offset >> 23);
+        const float m = std::bit_cast<float>(bits - offset);
+
+        // log2(m) = 2/ln(2) * atanh(t)
+        const float t = (m - 1.0f) / (m + 1.0f);
+        const float t2 = t * t;
+
+        return e + t * (2.8853900818f + t2 * (0.9617966939f + t2 * (0.5770780164f + t2 * 0.4121985831f)));
+    }
+
+    /// base^x for a positive base, relative error < 3e-7 + 1e-7 * |x * log2(base)|
+    inline float pow(float base, float x) noexcept
+    {
+        return exp2(x * std::log2(base));
+    }
+
+    namespace detail
+    {
+        /// sin(x + offset), where offset is within [0, pi/2] (added after the range reduction, so it doesn't cost precision)
+        inline float sinWithOffset(float x, float offset) noexcept
+        {
+            constexpr float pi = 3.141592654f;
+
+            // Remove whole turns to get into [-pi, pi] (Cody-Waite, 2 pi is split so that k * twoPiHigh is exact)
+            constexpr float twoPiHigh = 6.28125f, twoPiLow = 0.0019353071795864769f;
+            const float k = floor((x + offset) * 0.1591549431f + 0.5f);
+            float z = ((x - k * twoPiHigh) - k * twoPiLow) + offset;
+
+            // Fold into [-pi/2, pi/2] (z may slightly overshoot pi, hence the multiplication rather than copysign)
+            z = std::copysign(1.0f, z) * std::min(std::abs(z), pi - std::abs(z));
+
+            const float z2 = z * z;
+
+            // Chebyshev fit of sin(z) / z over z^2
+            return z * (0.9999999957f + z2 * (-0.1666665795f + z2 * (0.0083330502f + z2 * (-0.0001980902f + z2 * 0.0000026051f))));
+        }
+    }
+
+    /// sin(x), absolute error < 5e-7 + 2e-11 * |x|
+    inline float sin(float x) noexcept
+    {
+        return detail::sinWithOffset(x, 0.0f);
+    }
+
+    /// cos(x), absolute error < 5e-7 + 2e-11 * |x|
+    inline float cos(float x) noexcept
+    {
+        return detail::sinWithOffset(x, 1.570796327f);
+    }
+
+    /// tanh(x), absolute error < 3e-7
+    inline float tanh(float x) noexcept
+    {
+        // tanh(x) = 1 - 2 / (e^2x + 1), exp2() saturating takes care of large inputs
+        const float e = exp2(x * 2.8853900818f);
+        return 1.0f - 2.0f / (e + 1.0f);
+    }
+
+    /// Converts dB into an amplitude factor, relative error < 3e-7 + 2e-8 * |db|
+    inline float db_to_a(float db) noexcept
+    {
+        return exp2(db * 0.1660964047f);
+    }
+
+    /// Converts a (positive) amplitude factor into dB, absolute error < 3e-6 + 2e-7 * |dB|
+    inline float a_to_db(float a) noexcept
+    {
+        return log2(a) * 6.0205999133f;
+    }
+
+    /// A power function for a base known up front (e.g. the pow(5, cv) of our frequency inlets)
+    struct Pow
+    {
+        explicit Pow(float base) : log2Base(std::log2(base)) {}
+
+        float operator() (float x) const noexcept { return exp2(x * log2Base); }
+
+        /// Fills `out` with base^in, `in` and `out` may be the same array
+        void process(const float* in, float* out, int numSamples) const noexcept
+        {
+            for (int n = 0; n < numSamples; ++n)
+                out[n] = exp2(in[n] * log2Base);
+        }
+
+    private:
+        float log2Base;
+    };
+
+    /// Applies any of the functions above to a whole array, `in` and `out` may be the same array
+    template <float (*Function)(float)>
+    inline void process(const float* in, float* out, int numSamples) noexcept
+    {
+        for (int n = 0; n < numSamples; ++n)
+            out[n] = Function(in[n]);
+    }
+}
+
+/// Steps linearly from a value at the first sample of a block to a value at its last sample
+template <std::floating_point T>
+struct BlockRamp
+{
+    BlockRamp(T first, T last, int numSamples) noexcept :
+    value(first),
+    increment(numSamples > 1 ? (last - first) / (T)(numSamples - 1) : (T)0.0)
+    {}
+    
+    /// Returns the current value and steps to the next sample
+    T next() noexcept {
+        const T current = value;
+        value += increment;
+        return current;
+    }
+    
+private:
+    T value, increment;
+};
+
+/**
+ A small random number generator for noise, made of independent xorshift32 lanes.
+ The lanes don't depend on each other, so filling a block vectorises instead of being one long serial chain,
+ and it's seeded per instance (see ModuleProcessor::getRandomSeed()) so renders come out the same every time.
+ */
+class BlockRandom
+{
+public:
+    static constexpr int numLanes = 8;
+    
+    explicit BlockRandom (juce::uint64 seed = 0) noexcept { setSeed(seed); }
+    
+    /// Restarts every lane from the seed, nearby seeds give unrelated sequences
+    void setSeed (juce::uint64 seed) noexcept
+    {
+        for (auto& lane : lanes) {
+            // splitmix64, xorshift must never start from 0
+            seed += 0x9e3779b97f4a7c15;
+            auto z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            lane = std::max((juce::uint32)((z ^ (z >> 31)) >> 32), 1u);
+        }
+        
+        nextLane = 0;
+    }
+    
+    /// [0, 1)
+    float nextFloat() noexcept
+    {
+        const float value = toUniform(step(lanes[(size_t)nextLane]));
+        nextLane = (nextLane + 1) % numLanes;
+        return value;
+    }
+    
+    /// [-1, 1)
+    float nextBipolar() noexcept { return nextFloat() * 2.0f - 1.0f; }
+    
+    /// Fills `out` with uniform values in [0, 1)
+    void fillUniform (float* out, int numSamples) noexcept
+    {
+        int n = 0;
+        
+        for (; n + numLanes <= numSamples; n += numLanes)
+            for (int lane = 0; lane < numLanes; ++lane)
+                out[n + lane] = toUniform(step(lanes[(size_t)lane]));
+        
+        for (; n < numSamples; ++n)
+            out[n] = nextFloat();
+    }
+    
+    /// Fills `out` with uniform values in [-1, 1)
+    void fillBipolar (float* out, int numSamples) noexcept
+    {
+        fillUniform(out, numSamples);
+        
+        for (int n = 0; n < numSamples; ++n)
+            out[n] = out[n] * 2.0f - 1.0f;
+    }
+    
+private:
+    std::array<juce::uint32, numLanes> lanes;
+    int nextLane = 0;
+    
+    static juce::uint32 step (juce::uint32& state) noexcept
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    
+    /// The top 24 bits, exactly representable in a float
+    static float toUniform (juce::uint32 bits) noexcept
+    {
+        return (float)(int)(bits >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+/// How a DelayLine wraps its indices
+enum class DelayWrap {
+    /// Any size, every access costs an integer division
+    Modulo,
+    /// The size is rounded up to a power of two, every access is a bitmask
+    PowerOfTwo
+};
+
+/// The fractional delay kernels of DelayLine::read()
+enum class DelayInterpolation {
+    /// 2 taps, attenuates high frequencies at fractional delays
+    Linear,
+    /// 4 taps (cubic Lagrange), flatter magnitude than linear, needs a delay of at least 1 sample
+    Lagrange3,
+    /// 2 taps plus a first order allpass (Thiran), flat magnitude, needs a ThiranState per read and a delay of at least 1 sample
+    Thiran
+};
+
+/**
+ A delay line of Type samples, the most recent sample is at a delay of 0.
+ Reads and writes can be done a sample at a time (push, get, read) or a block at a time (write, readBlock).
+*/
+template <typename Type, DelayWrap Wrap = DelayWrap::Modulo>
 class DelayLine
 {
 public:
+    /// The allpass memory of a Thiran read, keep one per read position (and read it once per sample)
+    struct ThiranState { Type previousInput = Type (0), previousOutput = Type (0); };
+    
     void clear() noexcept
     {
-        std::fill (rawData.begin(), rawData.end(), Type (0));
+        std::fill (rawData, rawData + length, Type (0));
     }
 
     size_t size() const noexcept
     {
-        return rawData.size();
+        return length;
+    }
+    
+    /// The size the line actually takes to hold `numSamples` (in PowerOfTwo mode, the next power of two)
+    static size_t roundSize (size_t numSamples) noexcept
+    {
+        if constexpr (Wrap == DelayWrap::PowerOfTwo)
+            return (size_t)juce::nextPowerOfTwo((int)std::max<size_t>(1, numSamples));
+        else
+            return numSamples;
     }
 
+    /// Allocates the line's own memory, rounding the size with roundSize()
     void resize (size_t newValue)
     {
-        rawData.resize (newValue);
+        ownedData.resize (roundSize (newValue));
+        setMemory (ownedData.data(), ownedData.size());
+    }
+    
+    /** Uses memory that's owned elsewhere (e.g. a MemoryArena), it must outlive its use here.
+        The size must come from roundSize(), the contents aren't cleared */
+    void setMemory (Type* memory, size_t newSize) noexcept
+    {
+        jassert (newSize == roundSize (newSize));
+        
+        rawData = memory;
+        length = newSize;
+        mask = newSize - 1;
         leastRecentIndex = 0;
     }
 
@@ -98,18 +385,60 @@ public:
     {
         jassert (delayInSamples >= 0 && delayInSamples < size());
 
-        return rawData[(leastRecentIndex + 1 + delayInSamples) % size()];
+        return rawData[wrap(leastRecentIndex + 1 + delayInSamples)];
     }
     
     Type getInterpolated (float delayInSamples) const noexcept
     {
+        return read<DelayInterpolation::Linear>(delayInSamples);
+    }
+    
+    /// Reads between samples with one of the stateless kernels
+    template <DelayInterpolation Interpolation>
+    Type read (float delayInSamples) const noexcept
+    {
+        static_assert (Interpolation != DelayInterpolation::Thiran, "Thiran reads need a ThiranState");
         jassert (delayInSamples >= 0.0f && delayInSamples < static_cast<float>(size()));
         
-        float position = static_cast<float>(leastRecentIndex + 1) + delayInSamples;
-        float lowIndex = floor(position);
-        size_t index = static_cast<size_t>(lowIndex);
+        const size_t delay = static_cast<size_t>(delayInSamples);
+        const Type fraction = static_cast<Type>(delayInSamples - static_cast<float>(delay));
+        const size_t index = leastRecentIndex + 1 + delay;
         
-        return mix(rawData[index % size()], rawData[(index + 1) % size()], position - lowIndex);
+        if constexpr (Interpolation == DelayInterpolation::Linear) {
+            return mix(rawData[wrap(index)], rawData[wrap(index + 1)], fraction);
+        } else {
+            jassert (delayInSamples >= 1.0f && delayInSamples < static_cast<float>(size()) - 2.0f);
+            
+            const Type x0 = rawData[wrap(index - 1)], x1 = rawData[wrap(index)];
+            const Type x2 = rawData[wrap(index + 1)], x3 = rawData[wrap(index + 2)];
+            
+            // The Lagrange polynomial through the taps at -1, 0, 1 and 2
+            const Type d = fraction;
+            const Type dPlus1 = d + Type (1), dMinus1 = d - Type (1), dMinus2 = d - Type (2);
+            
+            return x0 * (-d * dMinus1 * dMinus2 / Type (6))
+                 + x1 * (dPlus1 * dMinus1 * dMinus2 / Type (2))
+                 + x2 * (-dPlus1 * d * dMinus2 / Type (2))
+                 + x3 * (dPlus1 * d * dMinus1 / Type (6));
+        }
+    }
+    
+    /// Reads between samples through a first order allpass, the fraction is kept within [0.618, 1.618) where it's best behaved
+    Type read (float delayInSamples, ThiranState& state) const noexcept
+    {
+        jassert (delayInSamples >= 1.0f && delayInSamples < static_cast<float>(size()) - 1.0f);
+        
+        const size_t delay = static_cast<size_t>(delayInSamples - 0.618f);
+        const Type fraction = static_cast<Type>(delayInSamples - static_cast<float>(delay));
+        const Type eta = (Type (1) - fraction) / (Type (1) + fraction);
+        
+        const Type input = rawData[wrap(leastRecentIndex + 1 + delay)];
+        const Type output = eta * (input - state.previousOutput) + state.previousInput;
+        
+        state.previousInput = input;
+        state.previousOutput = output;
+        
+        return output;
     }
 
     /** Set the specified sample in the delay line */
@@ -117,33 +446,72 @@ public:
     {
         jassert (delayInSamples >= 0 && delayInSamples < size());
 
-        rawData[(leastRecentIndex + 1 + delayInSamples) % size()] = newValue;
+        rawData[wrap(leastRecentIndex + 1 + delayInSamples)] = newValue;
     }
 
     /** Adds a new value to the delay line, overwriting the least recently added sample */
     void push (Type valueToAdd) noexcept
     {
         rawData[leastRecentIndex] = valueToAdd;
-        leastRecentIndex = leastRecentIndex == 0 ? size() - 1 : leastRecentIndex - 1;
+        leastRecentIndex = wrap(leastRecentIndex + size() - 1);
+    }
+    
+    /** Pushes a block of samples, in order */
+    void write (const Type* samples, int numSamples) noexcept
+    {
+        for (int n = 0; n < numSamples; ++n)
+            push(samples[n]);
+    }
+    
+    /** Reads the last numSamples written, each one delayed by delayInSamples (counting from when it was written).
+        Meant to follow write(), with delayInSamples + numSamples within the size of the line */
+    void readBlock (Type* destination, int numSamples, size_t delayInSamples) const noexcept
+    {
+        jassert (delayInSamples + (size_t)numSamples <= size());
+        
+        // The most recent sample is the last one of the block
+        for (int n = 0; n < numSamples; ++n)
+            destination[n] = get((size_t)(numSamples - 1 - n) + delayInSamples);
     }
 
 private:
-    std::vector<Type> rawData;
-    size_t leastRecentIndex = 0;
+    Type* rawData = nullptr;
+    size_t length = 0, leastRecentIndex = 0, mask = 0;
+    std::vector<Type> ownedData;
+    
+    size_t wrap (size_t index) const noexcept
+    {
+        if constexpr (Wrap == DelayWrap::PowerOfTwo)
+            return index & mask;
+        else
+            return index % length;
+    }
 };
 
 template <typename Type>
 struct OnePole {
     void setCutoff (float cutoffInHz) noexcept
     {
-        using fast = juce::dsp::FastMathApproximations;
-        
         if (cutoffInHz == cutoff) return;
         
-        mixFactor = clip(fast::exp(cutoffInHz * sampleFactor), 0.0f, 0.99999f);
+        mixFactor = getMixFactor(cutoffInHz);
         cutoff = cutoffInHz;
     }
     
+    /// The coefficient for a cutoff, it can be interpolated and set with setMixFactor() instead of calling setCutoff() every sample
+    float getMixFactor (float cutoffInHz) const noexcept
+    {
+        using fast = juce::dsp::FastMathApproximations;
+        
+        return clip(fast::exp(cutoffInHz * sampleFactor), 0.0f, 0.99999f);
+    }
+    
+    void setMixFactor (float newMixFactor) noexcept
+    {
+        mixFactor = newMixFactor;
+        cutoff = -1.0f; // The next setCutoff() must compute it again
+    }
+    
     Type process (Type input) noexcept
     {
         return previous = mix(input, previous, mixFactor);
@@ -216,7 +584,9 @@ class StateVariableFilter
     public:
     struct Output { float low, band, high; };
     
-    StateVariableFilter() = default;
+    StateVariableFilter() {
+        freqFactors.prepare(freqLimit, thetaFactor);
+    }
     
     void reset() {
         stage.reset();
@@ -226,30 +596,33 @@ class StateVariableFilter
     {
         freqLimit = sampleRate * 0.454f;
         thetaFactor = Const::pi * (1.0f / (sampleRate * 2.0f));
+        freqFactors.prepare(freqLimit, thetaFactor);
         
         reset();
     }
     
+    /// What process() can leave out for a block
+    struct Hints {
+        /// The modulation moves slowly, in a straight line, across the block, so coefficients are computed at its ends and interpolated
+        bool freqModIsControlRate = false, resModIsControlRate = false;
+        /// Band and high channels are left untouched when they're not needed
+        bool needsBand = true, needsHigh = true;
+    };
+    
     /// First channel is input returns buffer with lowpass on channel 0, bandpass on channel 1 and highpass on channel 2
-    /// freqMod must be valid up to numSamples-1!
-    /// resMod must be valid up to numSamples-1!
-    void process(juce::AudioBuffer<float>& buffer, const float* freqMod = nullptr, const float* resMod = nullptr)
+    /// freqMod must be valid up to numSamples-1! (or nullptr, when unmodulated)
+    /// resMod must be valid up to numSamples-1! (or nullptr, when unmodulated)
+    void process(juce::AudioBuffer<float>& buffer, const float* freqMod = nullptr, const float* resMod = nullptr, Hints hints = {})
     {
-        int numSamples = buffer.getNumSamples();
-        
-        const float* inSamples = buffer.getReadPointer(0);
-        float* lowSamples = buffer.getWritePointer(0);
-        float* bandSamples = buffer.getWritePointer(1);
-        float* highSamples = buffer.getWritePointer(2);
+        // Pick a loop that only does what's needed, the conditions don't change within the block
+        const int variant = (freqMod != nullptr && !hints.freqModIsControlRate)
+                          | (resMod != nullptr && !hints.resModIsControlRate) << 1
+                          | hints.needsBand << 2
+                          | hints.needsHigh << 3;
         
-        for (int i = 0; i < numSamples; ++i) {
-            auto output = processSample(inSamples[i],
-                                        freqMod ? freqMod[i] : 0.0f,
-                                        resMod ? resMod[i] : 0.0f);
-            lowSamples[i] = output.low;
-            bandSamples[i] = output.band;
-            highSamples[i] = output.high;
-        }
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((variant == (int)I ? processBlock<(I & 1) != 0, (I & 2) != 0, (I & 4) != 0, (I & 8) != 0>(buffer, freqMod, resMod) : void()), ...);
+        }(std::make_index_sequence<16>{});
     }
     
     Output processSample(float sample, float freqMod = 0.0f, float resMod = 0.0f) noexcept
@@ -258,7 +631,10 @@ class StateVariableFilter
     }
     
     /// [20.0 - SR/2] - the cutoff/peak frequency of the filter
-    void setFrequency(float newFrequency) { frequency = newFrequency; }
+    void setFrequency(float newFrequency) {
+        frequency = newFrequency;
+        frequencyOctave = std::log2(std::max(newFrequency, 1.0f));
+    }
     
     /// [0.0 - 1.0] - the feedback resonance of the filter
     void setResonance(float newResonance) { resonance = newResonance; }
@@ -282,7 +658,79 @@ class StateVariableFilter
     using fast = juce::dsp::FastMathApproximations;
     using Const = juce::MathConstants<float>;
     float freqLimit = 20000.0f, thetaFactor = 0.00003561896433f;
-    float frequency = 20.0f, resonance = 0.85f;
+    float frequency = 20.0f, frequencyOctave = 4.3219280949f, resonance = 0.85f;
+    
+    /// The frequency factors by octave (log2 of the frequency), dense enough to interpolate linearly (< 2e-5 relative error)
+    struct FreqFactorTable {
+        static constexpr int pointsPerOctave = 64;
+        
+        /// Called from prepare(), it's the only place the table gets (re)allocated
+        void prepare(float freqLimit, float thetaFactor) {
+            minOctave = std::log2(20.0f);
+            maxOctave = std::log2(std::max(freqLimit, 40.0f));
+            
+            // The last point lands exactly on the limit, so no cell straddles the clipping
+            const int numIntervals = (int)std::ceil((maxOctave - minOctave) * (float)pointsPerOctave);
+            pointsPerUnit = (float)numIntervals / (maxOctave - minOctave);
+            
+            // One extra point, the top of the range may round up into it
+            points.resize((size_t)numIntervals + 2);
+            
+            for (size_t i = 0; i < points.size(); ++i) {
+                const float freq = clip(std::exp2(minOctave + (float)i / pointsPerUnit), 20.0f, freqLimit);
+                points[i] = 2.0f * std::sin(freq * thetaFactor);
+            }
+        }
+        
+        /// Octaves beyond [20Hz - freqLimit] are clipped, like calculateFreqFactor()
+        float get(float octave) const noexcept {
+            const float x = (clip(octave, minOctave, maxOctave) - minOctave) * pointsPerUnit;
+            const int index = (int)x;
+            const float fraction = x - (float)index;
+            
+            return points[(size_t)index] + fraction * (points[(size_t)index + 1] - points[(size_t)index]);
+        }
+        
+    private:
+        std::vector<float> points;
+        float minOctave = 0.0f, maxOctave = 0.0f, pointsPerUnit = 1.0f;
+    } freqFactors;
+    
+    /// FreqMod and ResMod select the per-sample (audio rate) modulation paths
+    template <bool FreqMod, bool ResMod, bool Band, bool High>
+    void processBlock(juce::AudioBuffer<float>& buffer, const float* freqMod, const float* resMod) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        
+        const float* inSamples = buffer.getReadPointer(0);
+        float* lowSamples = buffer.getWritePointer(0);
+        float* bandSamples = Band ? buffer.getWritePointer(1) : nullptr;
+        float* highSamples = High ? buffer.getWritePointer(2) : nullptr;
+        
+        // Otherwise, coefficients only need computing at both ends of the block (or once, unmodulated)
+        auto freqFactor = rampOver(numSamples, freqMod, [this] (float mod) { return calculateFreqFactor(frequency * fastmath::pow(5.0f, mod)); });
+        auto res = rampOver(numSamples, resMod, [this] (float mod) { return getResonance(resonance + mod); });
+        
+        for (int i = 0; i < numSamples; ++i) {
+            auto output = stage.process(inSamples[i],
+                                        FreqMod ? getModdedFreqFactor(freqMod[i]) : freqFactor.next(),
+                                        ResMod ? getResonance(resonance + resMod[i]) : res.next());
+            lowSamples[i] = output.low;
+            if constexpr (Band) bandSamples[i] = output.band;
+            if constexpr (High) highSamples[i] = output.high;
+        }
+    }
+    
+    template <typename Function>
+    static BlockRamp<float> rampOver(int numSamples, const float* mod, Function&& function) noexcept
+    {
+        if (mod == nullptr || numSamples == 0) {
+            const float value = function(0.0f);
+            return { value, value, numSamples };
+        }
+        
+        return { function(mod[0]), function(mod[numSamples - 1]), numSamples };
+    }
     
     struct Stage {
         float lastInput = 0.0f, low = 0.0f, band = 0.0f;
@@ -311,13 +759,16 @@ class StateVariableFilter
     } stage;
     
     float calculateFreqFactor(float freq) {
-        return 2.0f * fast::sin(clip(freq, 20.0f, freqLimit) * thetaFactor);
+        return 2.0f * fastmath::sin(clip(freq, 20.0f, freqLimit) * thetaFactor);
     }
     
-    float getModdedFreqFactor(float freqMod) {
-        return calculateFreqFactor(frequency * pow(5.0f, freqMod));
+    /// Per sample modulation, looked up: the CV is in octaves of 5 (freq * 5^mod), so it's a single multiply-add into the table
+    float getModdedFreqFactor(float freqMod) const noexcept {
+        return freqFactors.get(frequencyOctave + freqMod * log2Of5);
     }
     
+    static constexpr float log2Of5 = 2.3219280949f;
+    
     constexpr float peakBandGain(float gainDB, float res) {
         return db_to_a(gainDB) / (1.204819f * res - 0.02409638f);
     }
@@ -328,3 +779,136 @@ class StateVariableFilter
 
    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StateVariableFilter)
 };
+/**
+ Runs as many independent state variable filters as there are SIMD lanes (4 with SSE/NEON, 8 with AVX) in a single pass.
+ Every lane has its own frequency, resonance and modulation, and sounds like a StateVariableFilter with the same settings.
+ Use one lane per voice or channel, so filtering a chord costs close to filtering a single note.
+ */
+class SIMDStateVariableFilter
+{
+    public:
+    using Vector = juce::dsp::SIMDRegister<float>;
+    static constexpr int numLanes = (int)Vector::SIMDNumElements;
+    
+    SIMDStateVariableFilter()
+    {
+        frequencies.fill(20.0f);
+        resonances.fill(0.85f);
+    }
+    
+    void reset() {
+        lastInput = low = band = Vector::expand(0.0f);
+    }
+    
+    void prepare(float sampleRate)
+    {
+        freqLimit = sampleRate * 0.454f;
+        thetaFactor = Const::pi * (1.0f / (sampleRate * 2.0f));
+        
+        reset();
+    }
+    
+    /// [20.0 - SR/2] - the cutoff/peak frequency of the filter in this lane
+    void setFrequency(int lane, float newFrequency) { frequencies[(size_t)lane] = newFrequency; }
+    
+    /// [0.0 - 1.0] - the feedback resonance of the filter in this lane
+    void setResonance(int lane, float newResonance) { resonances[(size_t)lane] = newResonance; }
+    
+    /**
+     * Filters up to numLanes signals side by side, each array holds one pointer per lane.
+     * Missing modulation (a null array or a null lane) counts as unmodulated, and null band/high arrays (or lanes) are skipped.
+     * Outputs may point at the inputs (like StateVariableFilter, it can process a buffer in place)
+     */
+    void process(int numChannels, int numSamples,
+                 const float* const* inputs, const float* const* freqMods, const float* const* resMods,
+                 float* const* lows, float* const* bands = nullptr, float* const* highs = nullptr) noexcept
+    {
+        jassert(numChannels <= numLanes);
+        
+        for (int start = 0; start < numSamples; start += chunkSize) {
+            const int numChunkSamples = std::min(chunkSize, numSamples - start);
+            
+            // Interleave the lanes, so every sample is one register
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const float* input = lane < numChannels ? inputs[lane] : nullptr;
+                const float* freqMod = lane < numChannels && freqMods != nullptr ? freqMods[lane] : nullptr;
+                const float* resMod = lane < numChannels && resMods != nullptr ? resMods[lane] : nullptr;
+                
+                for (int i = 0; i < numChunkSamples; ++i) {
+                    samples[i * numLanes + lane] = input != nullptr ? input[start + i] : 0.0f;
+                    freqFactors[i * numLanes + lane] = freqMod != nullptr ? freqMod[start + i] : 0.0f;
+                    resFactors[i * numLanes + lane] = resMod != nullptr ? resMod[start + i] : 0.0f;
+                }
+            }
+            
+            // The coefficients of the whole chunk at once, in a flat loop compilers vectorise
+            for (int i = 0; i < numChunkSamples * numLanes; ++i) {
+                const size_t lane = (size_t)(i & (numLanes - 1));
+                const float freq = clip(frequencies[lane] * fastmath::pow(5.0f, freqFactors[i]), 20.0f, freqLimit);
+                
+                freqFactors[i] = 2.0f * fastmath::sin(freq * thetaFactor);
+                resFactors[i] = 0.85f - clip(resonances[lane] + resFactors[i], 0.0f, 1.0f) * 0.83f;
+            }
+            
+            // Run the filters, outputs replace the scratch they were computed from
+            for (int i = 0; i < numChunkSamples; ++i) {
+                const int offset = i * numLanes;
+                
+                processSample(Vector::fromRawArray(samples + offset),
+                              Vector::fromRawArray(freqFactors + offset),
+                              Vector::fromRawArray(resFactors + offset));
+                
+                low.copyToRawArray(samples + offset);
+                band.copyToRawArray(freqFactors + offset);
+                highOutput.copyToRawArray(resFactors + offset);
+            }
+            
+            for (int lane = 0; lane < numChannels; ++lane) {
+                deinterleave(samples, lane, lows[lane], start, numChunkSamples);
+                
+                if (bands != nullptr && bands[lane] != nullptr)
+                    deinterleave(freqFactors, lane, bands[lane], start, numChunkSamples);
+                
+                if (highs != nullptr && highs[lane] != nullptr)
+                    deinterleave(resFactors, lane, highs[lane], start, numChunkSamples);
+            }
+        }
+    }
+    
+    private:
+    using Const = juce::MathConstants<float>;
+    float freqLimit = 20000.0f, thetaFactor = 0.00003561896433f;
+    std::array<float, numLanes> frequencies, resonances;
+    
+    // The same two runs as StateVariableFilter::Stage, on every lane
+    Vector lastInput = Vector::expand(0.0f), low = Vector::expand(0.0f), band = Vector::expand(0.0f), highOutput = Vector::expand(0.0f);
+    
+    void processSample(Vector sample, Vector freqFactor, Vector res) noexcept
+    {
+        //Run 1
+        low = low + freqFactor * band;
+        Vector high = (sample + lastInput) * 0.5f - low - res * band;
+        band = freqFactor * high + band;
+        
+        //Run 2
+        low = low + freqFactor * band;
+        highOutput = sample - low - res * band;
+        band = freqFactor * highOutput + band;
+        
+        lastInput = sample;
+    }
+    
+    static void deinterleave(const float* interleaved, int lane, float* destination, int start, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            destination[start + i] = interleaved[i * numLanes + lane];
+    }
+    
+    // Interleaved scratch (sample-major, one register per sample), reused for the outputs
+    static constexpr int chunkSize = 32;
+    alignas(Vector::SIMDRegisterSize) float samples[chunkSize * numLanes];
+    alignas(Vector::SIMDRegisterSize) float freqFactors[chunkSize * numLanes];
+    alignas(Vector::SIMDRegisterSize) float resFactors[chunkSize * numLanes];
+
+   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SIMDStateVariableFilter)
+};
@@ -18,6 +18,9 @@
 */
 struct FilterProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { freq, res };
+    
     FilterProcessor() :
     ModuleProcessor(
         3, // Inlets
@@ -44,20 +47,101 @@ struct FilterProcessor : ModuleProcessor
     
     void prepare (double newSampleRate, int maxBlockSize) override {
         filter.prepare(newSampleRate);
+        
+        // Polyphony runs a lane per voice
+        numBanks = getNumVoices() > 1 ? (getNumVoices() + Bank::numLanes - 1) / Bank::numLanes : 0;
+        banks = std::make_unique<Bank[]>((size_t)numBanks);
+        
+        for (int i = 0; i < numBanks; ++i)
+            banks[(size_t)i].prepare((float)newSampleRate);
     }
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
     {
-        filter.process(buffer, buffer.getReadPointer(1), buffer.getReadPointer(2));
+        auto& connections = getConnections();
+        
+        if (numBanks > 0) {
+            processVoices(buffer);
+            return;
+        }
+        
+        filter.process(buffer,
+                       connections.isInletConnected(1) ? buffer.getReadPointer(1) : nullptr,
+                       connections.isInletConnected(2) ? buffer.getReadPointer(2) : nullptr,
+                       {
+                           .freqModIsControlRate = connections.isControlRate(1),
+                           .resModIsControlRate = connections.isControlRate(2),
+                           .needsBand = connections.isOutletConnected(1),
+                           .needsHigh = connections.isOutletConnected(2)
+                       });
+    }
+    
+    void processSample (float* ports, int) override
+    {
+        const auto output = filter.processSample(ports[0], ports[1], ports[2]);
+        
+        ports[0] = output.low;
+        ports[1] = output.band;
+        ports[2] = output.high;
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "freq") filter.setFrequency(value);
-        else if (parameterID == "res") filter.setResonance(value * 0.01f);
+    /// Only a single voice, the banks run whole blocks
+    bool supportsSampleProcessing() const override { return getNumVoices() == 1; }
+    
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::freq: filter.setFrequency(value); frequency = value; break;
+            case Param::res: filter.setResonance(value * 0.01f); resonance = value * 0.01f; break;
+        }
     }
     
+    int getMaxNumVoices() const override { return maxNumVoices; }
+    
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<FilterUI>(*this); }
     
 private:
+    using Bank = SIMDStateVariableFilter;
+    
+    /// Runs a single voice
     StateVariableFilter filter;
+    
+    /// Run every voice when there's more than one, numLanes voices per bank
+    std::unique_ptr<Bank[]> banks;
+    int numBanks = 0;
+    
+    float frequency = 1000.0f, resonance = 0.25f;
+    
+    void processVoices (juce::AudioBuffer<float>& buffer)
+    {
+        auto& connections = getConnections();
+        
+        const float* inputs[Bank::numLanes] {};
+        const float* freqMods[Bank::numLanes] {};
+        const float* resMods[Bank::numLanes] {};
+        float* lows[Bank::numLanes] {};
+        float* bands[Bank::numLanes] {};
+        float* highs[Bank::numLanes] {};
+        
+        for (int bank = 0; bank < numBanks; ++bank) {
+            const int firstVoice = bank * Bank::numLanes;
+            const int numLanes = std::min(Bank::numLanes, getNumVoices() - firstVoice);
+            
+            for (int lane = 0; lane < numLanes; ++lane) {
+                const int voice = firstVoice + lane;
+                
+                banks[(size_t)bank].setFrequency(lane, frequency);
+                banks[(size_t)bank].setResonance(lane, resonance);
+                
+                inputs[lane] = buffer.getReadPointer(getChannel(0, voice));
+                freqMods[lane] = connections.isInletConnected(1) ? buffer.getReadPointer(getChannel(1, voice)) : nullptr;
+                resMods[lane] = connections.isInletConnected(2) ? buffer.getReadPointer(getChannel(2, voice)) : nullptr;
+                
+                lows[lane] = buffer.getWritePointer(getChannel(0, voice));
+                bands[lane] = connections.isOutletConnected(1) ? buffer.getWritePointer(getChannel(1, voice)) : nullptr;
+                highs[lane] = connections.isOutletConnected(2) ? buffer.getWritePointer(getChannel(2, voice)) : nullptr;
+            }
+            
+            banks[(size_t)bank].process(numLanes, buffer.getNumSamples(), inputs, freqMods, resMods, lows, bands, highs);
+        }
+    }
 };
@@ -18,10 +18,15 @@
 */
 struct FrictionProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { freq, jitter, drift, unison, detune };
+    
+    static constexpr int maxUnison = 16;
+    
     FrictionProcessor() :
     ModuleProcessor(
         3, // Inlets
-        1, // Outlets
+        3, // Outlets
         //============= Parameters =============
         std::make_unique<FloatParameter> (
             "freq",
@@ -43,6 +48,20 @@ struct FrictionProcessor : ModuleProcessor
             juce::NormalisableRange<float> (0.0f, 95.0f, 0.0, 0.5f),
             0.0f,
             FloatParameter::Attributes{}.withLabel("%")
+        ),
+        std::make_unique<juce::AudioParameterInt> (
+            "unison",
+            "Unison",
+            1,
+            maxUnison,
+            1
+        ),
+        std::make_unique<FloatParameter> (
+            "detune",
+            "Detune",
+            juce::NormalisableRange<float> (0.0f, 100.0f, 0.0f, 0.5f),
+            20.0f,
+            FloatParameter::Attributes{}.withLabel("%")
         )
     )
     {}
@@ -51,91 +70,213 @@ struct FrictionProcessor : ModuleProcessor
     
     void prepare (double newSampleRate, int maxBlockSize) override {
         sampleRate = newSampleRate;
-        sawtooth.prepare(newSampleRate);
+        sawtooth.prepare(newSampleRate, getRandomSeed());
+        sawtooth.setUnison(numUnison, detune);
     }
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
     {
-        float* samples = buffer.getWritePointer(0);
-        const float* freqCVSamples = buffer.getReadPointer(0);
-        const float* jitterCVSamples = buffer.getReadPointer(1);
-        const float* driftCVSamples = buffer.getReadPointer(2);
+        if (buffer.getNumSamples() == 0) return;
         
-        for (int n = 0; n < buffer.getNumSamples(); n++) {
-            *samples++ = sawtooth.process(
-                std::min(freq * pow(5.0f, *freqCVSamples++), 20000.0f),
-                clip(jitter + *jitterCVSamples++, 0.0f, 1.0f),
-                clip(drift + *driftCVSamples++, 0.0f, 1.0f)
-            );
+        if (unisonChanged) {
+            sawtooth.setUnison(numUnison, detune);
+            unisonChanged = false;
         }
+        
+        // A single copy runs as a plain sawtooth, more run in as many SIMD registers as they fill,
+        // and the spread outlets are only mixed when they're patched
+        const int numRegisters = numUnison == 1 ? 0 : (numUnison + laneWidth - 1) / laneWidth;
+        const bool spread = getConnections().isOutletConnected(1) || getConnections().isOutletConnected(2);
+        const int variant = numRegisters << 1 | (int)spread;
+        
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((variant == (int)I ? render<((I >> 1) == 0 ? 1 : (int)(I >> 1) * laneWidth), (I & 1) != 0>(buffer) : void()), ...);
+        }(std::make_index_sequence<2 * (maxUnison / laneWidth + 1)>{});
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "freq") freq = value;
-        else if (parameterID == "jitter") jitter = value * 0.01f;
-        else if (parameterID == "drift") drift = value * 0.01f;
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::freq: freq.setTarget(value); break;
+            case Param::jitter: jitter.setTarget(value * 0.01f); break;
+            case Param::drift: drift.setTarget(value * 0.01f); break;
+            case Param::unison: numUnison = juce::jlimit(1, maxUnison, (int)value); unisonChanged = true; break;
+            case Param::detune: detune = value * 0.01f; unisonChanged = true; break;
+        }
     }
     
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<FrictionUI>(*this); }
     
 private:
-    struct SawtoothGenerator {
-        void prepare(double newSampleRate) {
+    /// The number of copies that fit in one SIMD register
+    static constexpr int laneWidth = (int)juce::dsp::SIMDRegister<float>::SIMDNumElements;
+    static_assert(maxUnison % laneWidth == 0);
+    
+    /// Detuned copies of a PolyBLEP sawtooth, each with its own jitter and drift random walks.
+    /// The copies are laid out side by side (one array per variable), so every sample is a flat loop across them that compilers vectorise
+    struct UnisonSawtooth {
+        /// The detune at 100%, in semitones either way
+        static constexpr double maxDetune = 1.0;
+        
+        struct Output { float mix, left, right; };
+        
+        void prepare(double newSampleRate, juce::uint64 seed) {
             incrFactor = 1.0 / newSampleRate;
-            phase = 0.0f;
+            rng.setSeed(seed);
+            
+            // The first copy starts like a single sawtooth, the others anywhere so they don't start out in phase
+            for (int lane = 0; lane < maxUnison; ++lane) {
+                phases[lane] = lane == 0 ? 0.0 : (double)rng.nextFloat();
+                jitterFactors[lane] = 1.0;
+                driftValues[lane] = 1.0;
+            }
         }
         
-        float nextDriftValue() {
-            float f = driftValue + (rng.nextFloat() - 0.5f) * 0.1f;
+        /// Spreads the copies evenly across the detune (in pitch) and across left and right, copies past numUnison are muted
+        void setUnison(int newNumUnison, float detune) {
+            numUnison = newNumUnison;
             
-            // Fold
-            if (f >= 1.0f)
-                f = 1.0f - (f - 1.0);
-            else if (f <= -1.0f)
-                f = -1.0 - (f + 1.0);
+            // Uncorrelated copies add up in power
+            const float gain = 1.0f / std::sqrt((float)numUnison);
             
-            return f;
+            for (int lane = 0; lane < maxUnison; ++lane) {
+                const float offset = numUnison > 1 ? (float)lane * 2.0f / (float)(numUnison - 1) - 1.0f : 0.0f;
+                const float panAngle = (offset + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+                const bool isActive = lane < numUnison;
+                
+                detuneFactors[lane] = std::exp2((double)(detune * offset) * maxDetune / 12.0);
+                gains[lane] = isActive ? gain : 0.0f;
+                leftGains[lane] = isActive ? gain * std::cos(panAngle) : 0.0f;
+                rightGains[lane] = isActive ? gain * std::sin(panAngle) : 0.0f;
+            }
         }
-
-        float process (float freq, float jitter, float drift) {
-            double increment = (double)freq * incrFactor * jitterFactor * (1.0f + driftValue * drift);
-            
-            float saw = 2.0f * phase - 1.0f;
-            
-            saw -= blep(increment, phase);
-            
-            phase += increment;
+        
+        /// Runs the first NumLanes copies for one sample (NumLanes is 1 or a multiple of the SIMD width)
+        template <int NumLanes, bool Spread>
+        Output process (float freq, float jitter, float drift) noexcept {
+            const double baseIncrement = (double)freq * incrFactor;
+            int anyWrapped = 0;
             
-            if (phase >= 1.0) {
-                // jitter changes the frequency of the next period
-                jitterFactor = pow(4.0, jitter * (rng.nextFloat() - 0.5f));
+            for (int lane = 0; lane < NumLanes; ++lane) {
+                const double increment = baseIncrement * detuneFactors[lane] * jitterFactors[lane] * (1.0 + driftValues[lane] * (double)drift);
+                const double phase = phases[lane];
+                
+                saws[lane] = (float)(2.0 * phase - 1.0 - blep(increment, phase));
                 
-                // drift shifts the frequency in a random walk
-                driftValue = nextDriftValue();
+                const double nextPhase = phase + increment;
+                const int wrapped = (int)(nextPhase >= 1.0);
                 
-                phase -= 1.0;
+                phases[lane] = nextPhase - (double)wrapped;
+                wraps[lane] = wrapped;
+                anyWrapped |= wrapped;
             }
             
-            return saw;
+            if (anyWrapped)
+                for (int lane = 0; lane < std::min(NumLanes, numUnison); ++lane)
+                    if (wraps[lane])
+                        startNewPeriod(lane, jitter);
+            
+            if constexpr (NumLanes == 1)
+                return { saws[0] * gains[0], saws[0] * leftGains[0], saws[0] * rightGains[0] };
+            else
+                return { mixDown<NumLanes>(gains), Spread ? mixDown<NumLanes>(leftGains) : 0.0f, Spread ? mixDown<NumLanes>(rightGains) : 0.0f };
         }
         
     private:
-        juce::Random rng;
-        double phase = 0.0, incrFactor = 0.01, jitterFactor = 1.0, driftValue = 1.0;
-        
-        // A simple 3rd-order polynomial approximation for a BLEP.
-        static constexpr float blep (float dt, float t) {
-            if (t < dt) {
-                t /= dt;
-                return t * (2.0f - t) - 1.0f;
-            } else if (t > 1.0f - dt) {
-                t = (t - 1.0f) / dt;
-                return t * (t + 2.0f) + 1.0f;
-            }
-            return 0.0f;
+        BlockRandom rng;
+        double incrFactor = 0.01;
+        int numUnison = 1;
+        
+        alignas(64) double phases[maxUnison], jitterFactors[maxUnison], driftValues[maxUnison], detuneFactors[maxUnison];
+        alignas(64) float saws[maxUnison], gains[maxUnison], leftGains[maxUnison], rightGains[maxUnison];
+        alignas(64) int wraps[maxUnison];
+        
+        void startNewPeriod(int lane, float jitter) {
+            // jitter changes the frequency of the next period
+            jitterFactors[lane] = pow(4.0, jitter * (rng.nextFloat() - 0.5f));
+            
+            // drift shifts the frequency in a random walk
+            double f = driftValues[lane] + (rng.nextFloat() - 0.5f) * 0.1f;
+            
+            // Fold
+            if (f >= 1.0)
+                f = 1.0 - (f - 1.0);
+            else if (f <= -1.0)
+                f = -1.0 - (f + 1.0);
+            
+            driftValues[lane] = f;
+        }
+        
+        /// The copies' samples weighted by gains and summed, a register at a time
+        template <int NumLanes>
+        float mixDown(const float* laneGains) const noexcept {
+            using Vector = juce::dsp::SIMDRegister<float>;
+            static_assert(NumLanes % Vector::SIMDNumElements == 0);
+            
+            auto sum = Vector::expand(0.0f);
+            
+            for (int lane = 0; lane < NumLanes; lane += (int)Vector::SIMDNumElements)
+                sum = sum + Vector::fromRawArray(saws + lane) * Vector::fromRawArray(laneGains + lane);
+            
+            return sum.sum();
+        }
+        
+        /// A simple 2nd-order polynomial BLEP, written without branches so it vectorises
+        static double blep (double dt, double t) noexcept {
+            const double start = t / dt, end = (t - 1.0) / dt;
+            const double isStart = (double)(t < dt);
+            const double isEnd = (double)(t > 1.0 - dt) * (1.0 - isStart);
+            
+            return isStart * (start * (2.0 - start) - 1.0) + isEnd * (end * (end + 2.0) + 1.0);
         }
     } sawtooth;
     
-    float freq = 30.0f, jitter = 0.0f, drift = 0.0f;
+    ParameterSmoother freq { *this, ParameterSmoother::Exponential };
+    ParameterSmoother jitter { *this, ParameterSmoother::Linear };
+    ParameterSmoother drift { *this, ParameterSmoother::Linear };
     double sampleRate = 44100.0;
+    
+    int numUnison = 1;
+    float detune = 0.2f;
+    bool unisonChanged = false;
+    
+    template <int NumLanes, bool Spread>
+    void render (juce::AudioBuffer<float>& buffer) noexcept
+    {
+        float* samples = buffer.getWritePointer(0);
+        float* leftSamples = buffer.getWritePointer(1);
+        float* rightSamples = buffer.getWritePointer(2);
+        const float* freqCVSamples = buffer.getReadPointer(0);
+        const float* jitterCVSamples = buffer.getReadPointer(1);
+        const float* driftCVSamples = buffer.getReadPointer(2);
+        
+        const int numSamples = buffer.getNumSamples();
+        
+        const float* freqSamples = freq.getSamples();
+        const float* jitterSamples = jitter.getSamples();
+        const float* driftSamples = drift.getSamples();
+        
+        // With slow, straight CV the frequency only needs the transcendental math at both ends of the block
+        const bool rampFrequency = getConnections().isControlRate(0) && freq.isSteady();
+        BlockRamp<float> frequencyRamp (getFrequency(freq.getValue(), freqCVSamples[0]), getFrequency(freq.getValue(), freqCVSamples[numSamples - 1]), numSamples);
+        
+        // Every inlet is read before its sample is overwritten by an outlet
+        for (int n = 0; n < numSamples; n++) {
+            const auto output = sawtooth.process<NumLanes, Spread>(
+                rampFrequency ? frequencyRamp.next() : getFrequency(freqSamples[n], freqCVSamples[n]),
+                clip(jitterSamples[n] + jitterCVSamples[n], 0.0f, 1.0f),
+                clip(driftSamples[n] + driftCVSamples[n], 0.0f, 1.0f)
+            );
+            
+            samples[n] = output.mix;
+            
+            if constexpr (Spread) {
+                leftSamples[n] = output.left;
+                rightSamples[n] = output.right;
+            }
+        }
+    }
+    
+    static float getFrequency(float frequency, float cv) noexcept {
+        return std::min(frequency * fastmath::pow(5.0f, cv), 20000.0f);
+    }
 };
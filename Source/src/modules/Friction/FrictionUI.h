@@ -20,18 +20,22 @@ struct FrictionUI : ModuleUI
         // All modules must initialize these properties
         .name =  "Friction",
         .inlets = {"Freq", "Jitter", "Drift"},
-        .outlets = {"Out"},
-        .defaultSize = {270, 130},
-        .minimumSize = {233, 108},
+        .outlets = {"Out", "L", "R"},
+        .defaultSize = {270, 230},
+        .minimumSize = {233, 196},
         .processor = processor
     }),
     freqDial(*processor.params.getParameter("freq")),
     jitterDial(*processor.params.getParameter("jitter")),
-    driftDial(*processor.params.getParameter("drift"))
+    driftDial(*processor.params.getParameter("drift")),
+    unisonDial(*processor.params.getParameter("unison")),
+    detuneDial(*processor.params.getParameter("detune"))
     {
         addAndMakeVisible(freqDial);
         addAndMakeVisible(jitterDial);
         addAndMakeVisible(driftDial);
+        addAndMakeVisible(unisonDial);
+        addAndMakeVisible(detuneDial);
     }
     
     ~FrictionUI() {};
@@ -41,14 +45,18 @@ struct FrictionUI : ModuleUI
     void resized() override
     {
         auto bounds = getLocalBounds();
+        auto bottomRow = bounds.removeFromBottom(bounds.getHeight() / 2);
         
         int dialWidth = bounds.getWidth() / 3;
         
         freqDial.setBounds( bounds.removeFromLeft(dialWidth) );
         jitterDial.setBounds( bounds.removeFromLeft(dialWidth) );
         driftDial.setBounds( bounds );
+        
+        unisonDial.setBounds( bottomRow.removeFromLeft(bottomRow.getWidth() / 2) );
+        detuneDial.setBounds( bottomRow );
     }
 
 private:
-    PhiDial freqDial, jitterDial, driftDial;
+    PhiDial freqDial, jitterDial, driftDial, unisonDial, detuneDial;
 };
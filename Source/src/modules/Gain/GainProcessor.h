@@ -18,6 +18,9 @@
 */
 struct GainProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { gain };
+    
     GainProcessor() :
     ModuleProcessor(
         2, // Inlets
@@ -39,13 +42,37 @@ struct GainProcessor : ModuleProcessor
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
     {
-        float gain = db_to_a(params.getRawParameterValue("gain")->load());
         float* inOutSamples = buffer.getWritePointer(0);
         const float* gainCVSamples = buffer.getReadPointer(1);
+        const float* gainSamples = gain.getSamples();
+        
+        if (!getConnections().isInletConnected(1)) {
+            // The gain range (up to +12 dB) already stays within the clip
+            if (gain.isSteady())
+                juce::FloatVectorOperations::multiply(inOutSamples, clip(gain.getValue(), 0.0f, 4.0f), buffer.getNumSamples());
+            else
+                juce::FloatVectorOperations::multiply(inOutSamples, gainSamples, buffer.getNumSamples());
+            
+            return;
+        }
         
         for (int n = 0; n < buffer.getNumSamples(); n++)
-            *inOutSamples++ *= clip(gain + *gainCVSamples++, 0.0f, 4.0f);
+            inOutSamples[n] *= clip(gainSamples[n] + gainCVSamples[n], 0.0f, 4.0f);
+    }
+    
+    void processSample (float* ports, int index) override
+    {
+        ports[0] *= clip(gain.getSamples()[index] + ports[1], 0.0f, 4.0f);
+    }
+    
+    bool supportsSampleProcessing() const override { return true; }
+    
+    void parameterChanged (int parameterIndex, float value) override {
+        if ((Param)parameterIndex == Param::gain) gain.setTarget(db_to_a(value));
     }
     
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<GainUI>(*this); }
+    
+private:
+    ParameterSmoother gain { *this, ParameterSmoother::Exponential };
 };
@@ -18,6 +18,9 @@
 */
 struct GritProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { amount, density };
+    
     GritProcessor() :
     ModuleProcessor(
         3, // Inlets
@@ -44,6 +47,7 @@ struct GritProcessor : ModuleProcessor
     
     void prepare (double newSampleRate, int maxBlockSize) override {
         sampleRate = newSampleRate;
+        rng.setSeed(getRandomSeed());
     }
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
@@ -52,27 +56,52 @@ struct GritProcessor : ModuleProcessor
         const float* amountCVSamples = buffer.getReadPointer(1);
         const float* densityCVSamples = buffer.getReadPointer(2);
         
-        for (int n = 0; n < buffer.getNumSamples(); n++)
+        float random[chunkSize];
+        
+        for (int start = 0; start < buffer.getNumSamples(); start += chunkSize)
         {
-            float thresh = density + *densityCVSamples++;
-            float noise = (rng.nextFloat() < thresh) ? rng.nextBool() ? 0.5f : -0.5f : 0.0f;
-            
-            float gain = clip(amount + *amountCVSamples++, 0.0f, 1.0f);
-            noise = noise * gain + (1.0f - gain);
+            const int numSamples = std::min(chunkSize, buffer.getNumSamples() - start);
+            rng.fillBipolar(random, numSamples);
             
-            *inOutSamples++ *= noise;
+            for (int n = 0; n < numSamples; n++)
+            {
+                // One draw for both the density and the sign: |r| < thresh as often as thresh, and the sign is a coin toss
+                const float thresh = density + densityCVSamples[start + n];
+                float noise = std::abs(random[n]) < thresh ? std::copysign(0.5f, random[n]) : 0.0f;
+                
+                const float gain = clip(amount + amountCVSamples[start + n], 0.0f, 1.0f);
+                noise = noise * gain + (1.0f - gain);
+                
+                inOutSamples[start + n] *= noise;
+            }
         }
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "amount") amount = value * 0.01f;
-        else if (parameterID == "density") density = value * 0.01f;
+    void processSample (float* ports, int) override
+    {
+        const float random = rng.nextBipolar();
+        float noise = std::abs(random) < density + ports[2] ? std::copysign(0.5f, random) : 0.0f;
+        
+        const float gain = clip(amount + ports[1], 0.0f, 1.0f);
+        ports[0] *= noise * gain + (1.0f - gain);
+    }
+    
+    bool supportsSampleProcessing() const override { return true; }
+    
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::amount: amount = value * 0.01f; break;
+            case Param::density: density = value * 0.01f; break;
+        }
     }
     
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<GritUI>(*this); }
     
 private:
-    juce::Random rng;
+    /// Random values are drawn a chunk at a time
+    static constexpr int chunkSize = 64;
+    
+    BlockRandom rng;
     juce::IIRFilter filter;
     
     float amount = 0.0f, density = 0.0f;
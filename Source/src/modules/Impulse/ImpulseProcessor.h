@@ -11,7 +11,7 @@
 #pragma once
 
 
-// Definition is global for the UI to build a faithful representation
+/// The exact impulse, ImpulseTable holds it precomputed (this is the reference it's built to match)
 static constexpr float processImpulse(float phase, float shape)
 {
     const float shapeFactor = -std::max(shape, 0.88f) + 1.01f;
@@ -22,11 +22,15 @@ static constexpr float processImpulse(float phase, float shape)
     : sin((sin(phase))/((-shape + 1.006f)*(phase-juce::MathConstants<float>::pi)))*fundamentalAttenuator;
 }
 
+#include "ImpulseTable.h"
 #include "ImpulseUI.h"
 #include "../../dsp/ModuleProcessor.h"
 
 struct ImpulseProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { freq, shape, trigger, exact };
+    
     ImpulseProcessor() :
     ModuleProcessor(
         3, // Inlets
@@ -50,9 +54,17 @@ struct ImpulseProcessor : ModuleProcessor
            "trigger",
            "Trigger",
            false
+        ),
+        std::make_unique<juce::AudioParameterBool> (
+           "exact",
+           "Exact",
+           false
         )
     )
-    {}
+    {
+        // Build the shared table now, on the message thread, rather than in the first audio block
+        ImpulseTable::get();
+    }
     
     ~ImpulseProcessor() {}
     
@@ -63,25 +75,84 @@ struct ImpulseProcessor : ModuleProcessor
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
     {
-        double increment = (double)freq * incrFactor;
+        if (triggerParameterWasOn()) phase = 0.0;
+        
+        auto& connections = getConnections();
+        
+        // Only pay for the outlets that are patched, and for per-sample CV when it actually moves at audio rate
+        const int variant = !connections.isControlRate(1)
+                          | !connections.isControlRate(2) << 1
+                          | connections.isOutletConnected(0) << 2
+                          | connections.isOutletConnected(1) << 3
+                          | exact << 4;
+        
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            ((variant == (int)I ? render<(I & 1) != 0, (I & 2) != 0, (I & 4) != 0, (I & 8) != 0, (I & 16) != 0>(buffer) : void()), ...);
+        }(std::make_index_sequence<32>{});
+    }
+    
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::freq: freq = value; break;
+            case Param::shape: shape = pow(value * 0.01f, 0.2f); break;
+            case Param::trigger: break;
+            case Param::exact: exact = value > 0.5f; break;
+        }
+    }
+
+    std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<ImpulseUI>(*this); }
+    
+private:
+    static constexpr float invTwoPi = 1.0f/juce::MathConstants<float>::twoPi;
+    
+    double incrFactor = 1.0, phase = 0.0;
+    float previousTrigger = 0.0f;
+    float freq = 20.0f, shape = 0.0f;
+    bool exact = false;
+    
+    /// FreqCV and ShapeCV select the per-sample (audio rate) CV paths, control rate CV is interpolated from the ends of the block.
+    /// Exact evaluates processImpulse() for every sample instead of looking it up in the table
+    template <bool FreqCV, bool ShapeCV, bool Out, bool Ramp, bool Exact>
+    void render (juce::AudioBuffer<float>& buffer) noexcept
+    {
+        const int numSamples = buffer.getNumSamples();
+        if (numSamples == 0) return;
+        
+        const double increment = (double)freq * incrFactor;
+        
         const float* triggerSamples = buffer.getReadPointer(0);
         const float* freqCVSamples = buffer.getReadPointer(1);
         const float* shapeCVSamples = buffer.getReadPointer(2);
         float* outSamples = buffer.getWritePointer(0);
         float* rampSamples = buffer.getWritePointer(1);
         
-        if (triggerParameterWasOn()) phase = 0.0;
+        BlockRamp<double> incrementRamp (increment * (double)fastmath::pow(5.0f, freqCVSamples[0]),
+                                         increment * (double)fastmath::pow(5.0f, freqCVSamples[numSamples - 1]),
+                                         numSamples);
+        const auto& table = ImpulseTable::get();
         
-        // for now, we constantly process audio, but ideally, the module should know if it is connected
-        for (int n = 0; n < buffer.getNumSamples(); n++)
+        // The table is looked up by row, so that's what gets interpolated (the exact formula takes the shape itself)
+        const auto getShapeOrRow = [] (float shapeValue) { return Exact ? shapeValue : ImpulseTable::getRow(shapeValue); };
+        
+        BlockRamp<float> shapeRamp (getShapeOrRow(clip(shape + shapeCVSamples[0], 0.0f, 1.0f)),
+                                    getShapeOrRow(clip(shape + shapeCVSamples[numSamples - 1], 0.0f, 1.0f)),
+                                    numSamples);
+        
+        for (int n = 0; n < numSamples; n++)
         {
-            const float trigger = *triggerSamples++;
+            // An unpatched trigger inlet is silent, so it never triggers
+            const float trigger = triggerSamples[n];
             if ((previousTrigger - trigger) > 0.5f) phase = 0.0;
             
-            double nextPhase = phase + increment * (double)pow(5.0f, *freqCVSamples++);
+            double nextPhase = phase + (FreqCV ? increment * (double)fastmath::pow(5.0f, freqCVSamples[n]) : incrementRamp.next());
+            
+            const float shapeOrRow = ShapeCV ? getShapeOrRow(clip(shape + shapeCVSamples[n], 0.0f, 1.0f)) : shapeRamp.next();
             
-            *outSamples++ = processImpulse(phase, clip(shape + *shapeCVSamples++, 0.0f, 1.0f));
-            *rampSamples++ = std::min(1.0f, (float)phase * invTwoPi);
+            if constexpr (Out)
+                outSamples[n] = Exact ? processImpulse((float)phase, shapeOrRow) : table.lookup((float)phase, shapeOrRow);
+            
+            if constexpr (Ramp)
+                rampSamples[n] = std::min(1.0f, (float)phase * invTwoPi);
 
             phase = nextPhase;
             phase = std::min(std::numeric_limits<double>::max(), phase);
@@ -89,22 +160,8 @@ struct ImpulseProcessor : ModuleProcessor
         }
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "freq") freq = value;
-        else if (parameterID == "shape") shape = pow(value * 0.01f, 0.2f);
-    }
-
-    std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<ImpulseUI>(*this); }
-    
-private:
-    static constexpr float invTwoPi = 1.0f/juce::MathConstants<float>::twoPi;
-    
-    double incrFactor = 1.0, phase = 0.0;
-    float previousTrigger = 0.0f;
-    float freq = 20.0f, shape = 0.0f;
-    
     bool triggerParameterWasOn()
     {
-        return params.getRawParameterValue("trigger")->exchange(0.0f) > 0.0f;
+        return getRawParameter(Param::trigger).exchange(0.0f) > 0.0f;
     }
 };
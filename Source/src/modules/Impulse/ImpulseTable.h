@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    ImpulseTable.h
+    Created: 18 Oct 2026 11:58:14pm
+    Author:  Alexandre Rodrigues
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../dsp/Utils.h"
+
+/**
+ processImpulse() sampled over (shape, phase), looked up with bilinear interpolation.
+ Every point is the average of the impulse across its cell, so the table is band-limited to its own resolution
+ (at high shapes the impulse rings faster than any sample rate can hold, the exact formula aliases there).
+ There's only one, shared by every Impulse and the UI preview, it's built the first time get() is called.
+ */
+struct ImpulseTable
+{
+    /// The impulse has decayed below -150dB past this phase at any shape, it's silent from here on
+    static constexpr float maxPhase = 1024.0f;
+    static constexpr int pointsPerRadian = 16;
+    static constexpr int numRows = 65;
+    
+    static const ImpulseTable& get()
+    {
+        static const ImpulseTable table;
+        return table;
+    }
+    
+    /// The (fractional) row of a shape [0, 1], rows are spaced logarithmically towards the sharpest shapes.
+    /// It costs a log2(), compute it at the ends of a block and interpolate when the shape moves slowly
+    static float getRow(float shape) noexcept
+    {
+        return -rowsPerOctave * fastmath::log2(1.0f - clip(shape, 0.0f, 1.0f) / maxShapeDivisor);
+    }
+    
+    /// The impulse at a positive phase, for a row given by getRow()
+    float lookup(float phase, float row) const noexcept
+    {
+        if (phase >= maxPhase) return 0.0f;
+        
+        const float x = phase * (float)pointsPerRadian;
+        const int column = (int)x;
+        const float columnFraction = x - (float)column;
+        
+        const int rowIndex = std::min((int)row, numRows - 2);
+        const float rowFraction = row - (float)rowIndex;
+        
+        const float* top = points.data() + rowIndex * rowSize + column;
+        const float* bottom = top + rowSize;
+        
+        const float topValue = top[0] + columnFraction * (top[1] - top[0]);
+        const float bottomValue = bottom[0] + columnFraction * (bottom[1] - bottom[0]);
+        
+        return topValue + rowFraction * (bottomValue - topValue);
+    }
+    
+private:
+    /// processImpulse() divides by (maxShapeDivisor - shape), rows are spaced evenly in the log of that
+    static constexpr float maxShapeDivisor = 1.006f, minShapeDivisor = maxShapeDivisor - 1.0f;
+    static inline const float rowsPerOctave = (float)(numRows - 1) / std::log2(maxShapeDivisor / minShapeDivisor);
+    
+    static constexpr int rowSize = (int)maxPhase * pointsPerRadian + 1;
+    /// Impulses averaged across each cell
+    static constexpr int oversampling = 4;
+    
+    std::vector<float> points;
+    
+    ImpulseTable() : points ((size_t)(numRows * rowSize))
+    {
+        // processImpulse() factored into its phase and shape parts, so most of the work is done once per column or row
+        std::vector<float> phases ((size_t)(rowSize * oversampling)), carriers (phases.size());
+        
+        for (size_t i = 0; i < phases.size(); ++i) {
+            const float phase = std::max(0.0f, ((float)i + 0.5f) / (float)oversampling - 0.5f) / (float)pointsPerRadian;
+            
+            phases[i] = phase;
+            carriers[i] = phase == juce::MathConstants<float>::pi ? 0.0f : fastmath::sin(phase) / (phase - juce::MathConstants<float>::pi);
+        }
+        
+        for (int row = 0; row < numRows; ++row) {
+            const float shape = maxShapeDivisor * (1.0f - std::exp2(-(float)row / rowsPerOctave));
+            const float inverseDivisor = 1.0f / (maxShapeDivisor - shape);
+            const float shapeFactor = -std::max(shape, 0.88f) + 1.01f;
+            
+            float* rowPoints = points.data() + row * rowSize;
+            
+            for (int column = 0; column < rowSize; ++column) {
+                float sum = 0.0f;
+                
+                for (size_t i = (size_t)(column * oversampling); i < (size_t)((column + 1) * oversampling); ++i) {
+                    const float fundamentalAttenuator = -0.5f * fastmath::tanh(phases[i] * shapeFactor - 1.0f) + 0.5f;
+                    sum += fastmath::sin(carriers[i] * inverseDivisor) * fundamentalAttenuator;
+                }
+                
+                rowPoints[column] = sum / (float)oversampling;
+            }
+        }
+    }
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImpulseTable)
+};
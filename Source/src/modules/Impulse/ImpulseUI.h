@@ -13,6 +13,7 @@
 #include "../../ui/ModuleUI.h"
 #include "../../ui/component/PhiDial.h"
 #include "../../ui/component/PhiWaveform.h"
+#include "../../ui/component/PhiSliderButton.h"
 //==============================================================================
 /*
 */
@@ -24,12 +25,14 @@ struct ImpulseUI : ModuleUI
         .name =  "Impulse",
         .inlets = {"Trigger", "Freq", "Shape"},
         .outlets = {"Out", "Ramp"},
-        .defaultSize = {220, 220},
-        .minimumSize = {200, 167},
+        .defaultSize = {220, 250},
+        .minimumSize = {200, 197},
         .processor = processor
     }},
     frequencyDial(*processor.params.getParameter("freq")),
-    shapeDial(*processor.params.getParameter("shape"))
+    shapeDial(*processor.params.getParameter("shape")),
+    exactButton("Fast", "Exact"),
+    exactAttachment(*processor.params.getParameter("exact"), exactButton)
     {
         waveform.setInterceptsMouseClicks(false, false);
         waveform.setPaintingIsUnclipped(true);
@@ -38,6 +41,7 @@ struct ImpulseUI : ModuleUI
         addAndMakeVisible(waveform);
         addAndMakeVisible(frequencyDial);
         addAndMakeVisible(shapeDial);
+        addAndMakeVisible(exactButton);
         
         shapeDial.onValueChange = [&] () {updateWaveform();};
     }
@@ -56,6 +60,8 @@ struct ImpulseUI : ModuleUI
         
         bounds.removeFromBottom(5);
         
+        exactButton.setBounds(bounds.removeFromBottom(30).withSizeKeepingCentre(70, 30));
+        
         // Place the Dials
         frequencyDial.setBounds(bounds.removeFromLeft(bounds.getWidth() / 2));
         shapeDial.setBounds(bounds);
@@ -76,7 +82,7 @@ private:
         void set(float newShape)
         {
             newShape *= 0.95f;
-            shape = pow(newShape, 0.2f);
+            row = ImpulseTable::getRow(pow(newShape, 0.2f));
             scaleFactor = pow(newShape, 10.0f) * 200.0f + 30.0f;
             updateWavefom();
         }
@@ -86,7 +92,7 @@ private:
         {
             if (phase == 0.0f) return 0.0f;
             
-            return std::abs(processImpulse(phase * scaleFactor, shape)) * yScale;
+            return std::abs(ImpulseTable::get().lookup(phase * scaleFactor, row)) * yScale;
         }
         
         /**
@@ -103,13 +109,16 @@ private:
         
     private:
         const float yScale = 1.2f;
-        float shape = 0.5f, scaleFactor = 1.0f;
+        float row = 0.0f, scaleFactor = 1.0f;
     };
 
     ImpulseWaveform waveform;
     
     PhiDial frequencyDial, shapeDial;
     
+    PhiSliderButton exactButton;
+    juce::ButtonParameterAttachment exactAttachment;
+    
     void updateWaveform() {
         waveform.set(shapeDial.getValue() * 0.01f);
     }
@@ -63,8 +63,9 @@ struct LFO {
     
     static double note_rate_to_hz(double rate, double bpm) { return bpm / (NOTE_VALUES[rate_to_note_index(rate)] * 60.0); }
     
-    void prepare (double sample_rate) {
+    void prepare (double sample_rate, juce::uint64 seed = 0) {
         increment = 1.0 / sample_rate;
+        rng.setSeed(seed);
     }
     
     void set_note_mode(bool is_note_mode) { note_mode = is_note_mode; update_freq(); }
@@ -110,7 +111,7 @@ struct LFO {
             
             if (next_position >= 1.0) {
                 random_value = next_random_value;
-                next_random_value = rng.nextFloat() * 2.0f - 1.0f;
+                next_random_value = rng.nextBipolar();
             }
         }
         
@@ -119,23 +120,46 @@ struct LFO {
         return value;
     }
     
+    /// Renders a block. The rate [0 - 1] and shape [-1 - 1] are read once, rate_cv and shape_cv are added to them per sample
+    /// (nullptr when there's no CV). `out` may be the same array as rate_cv, but not shape_cv
+    void render(float* out, const float* rate_cv, const float* shape_cv, int num_samples) {
+        if (num_samples <= 0) return;
+        
+        const Wave block_wave = wave;
+        const float block_shape = clip((float)shape, -1.0f, 1.0f), block_phase = phase;
+        
+        if (block_wave == Wave::Random) {
+            render_random(out, rate_cv, shape_cv, num_samples, block_shape, block_phase);
+            return;
+        }
+        
+        render_phases(out, rate_cv, num_samples, block_phase);
+        
+        if (block_wave == Wave::Sine)
+            shape_wave<Wave::Sine>(out, shape_cv, num_samples, block_shape);
+        else if (block_wave == Wave::Triangle)
+            shape_wave<Wave::Triangle>(out, shape_cv, num_samples, block_shape);
+        else /* (block_wave == Wave::Square) */
+            shape_wave<Wave::Square>(out, shape_cv, num_samples, block_shape);
+    }
+    
     void skip(int num_samples) {
         double next_position = position + freq * increment * (double)num_samples;
         
         if (wave == Wave::Random && next_position >= 1.0) {
             random_value = next_random_value;
-            next_random_value = rng.nextFloat() * 2.0f - 1.0f;
+            next_random_value = rng.nextBipolar();
         }
         
         position = mod(next_position, 1.0);
     }
     
     static float get_sine (float pos, float shape) {
-        float sine = sin(pos * two_pi);
+        float sine = fastmath::sin(pos * two_pi);
         float warped;
         
         if (shape > 0.0f) {
-            warped = tanh(sine * (pow(shape, 10.0f) + 0.2f) * 20.0f);
+            warped = fastmath::tanh(sine * (pow(shape, 10.0f) + 0.2f) * 20.0f);
             return sine * (1.0f - abs(shape)) + warped * abs(shape);
         } else {
             float sign = sine >= 0.0f ? 1.0f : -1.0f;
@@ -176,12 +200,114 @@ private:
     std::atomic<bool> note_mode = false;
     std::atomic<double> freq = 0.0;
     std::atomic<Wave> wave;
-    juce::Random rng;
+    BlockRandom rng;
     
     void update_freq() {
-        if (note_mode)
-            freq = note_rate_to_hz(rate, bpm);
-        else
-            freq = rate_to_hz(rate);
+        freq = get_freq(rate, note_mode);
+    }
+    
+    double get_freq(double new_rate, bool is_note_mode) const {
+        return is_note_mode ? note_rate_to_hz(new_rate, bpm) : rate_to_hz(new_rate);
+    }
+    
+    /// Fills `out` with each sample's phase [0 - 1), advancing the position
+    void render_phases(float* out, const float* rate_cv, int num_samples, float block_phase) {
+        if (rate_cv == nullptr) {
+            // A constant rate, every phase is known up front and the loop vectorises
+            const double step = freq * increment;
+            const double start = position + (double)block_phase;
+            
+            for (int n = 0; n < num_samples; ++n)
+                out[n] = (float)frac(start + step * (double)n);
+            
+            position = mod(position + step * (double)num_samples, 1.0);
+            return;
+        }
+        
+        const double block_rate = rate;
+        const bool is_note_mode = note_mode;
+        
+        for (int n = 0; n < num_samples; ++n) {
+            const double sample_increment = get_freq(clip(block_rate + (double)rate_cv[n], 0.0, 1.0), is_note_mode) * increment;
+            
+            out[n] = (float)frac(position + (double)block_phase);
+            position = mod(position + sample_increment, 1.0);
+        }
+    }
+    
+    /// Turns the phases in `out` into the wave, without shape CV the shape is hoisted out of the loop so it vectorises
+    template <Wave W>
+    static void shape_wave(float* out, const float* shape_cv, int num_samples, float s) {
+        if (shape_cv != nullptr) {
+            for (int n = 0; n < num_samples; ++n) {
+                const float sample_shape = clip(s + shape_cv[n], -1.0f, 1.0f);
+                
+                if constexpr (W == Wave::Sine) out[n] = get_sine(out[n], sample_shape);
+                if constexpr (W == Wave::Triangle) out[n] = get_triangle(out[n], sample_shape);
+                if constexpr (W == Wave::Square) out[n] = get_square(out[n], sample_shape);
+            }
+        }
+        else if constexpr (W == Wave::Sine) {
+            if (s > 0.0f) {
+                // Mixed with a saturated sine
+                const float s2 = s * s, s4 = s2 * s2;
+                const float drive = (s4 * s4 * s2 + 0.2f) * 20.0f;
+                
+                for (int n = 0; n < num_samples; ++n) {
+                    const float sine = fastmath::sin(out[n] * two_pi);
+                    out[n] = sine * (1.0f - s) + fastmath::tanh(sine * drive) * s;
+                }
+            } else if (s < 0.0f) {
+                // Raised to a power, keeping the sign
+                const float s2 = s * s;
+                const float exponent = s2 * s2 * 100.0f + 1.0f;
+                
+                for (int n = 0; n < num_samples; ++n) {
+                    const float sine = fastmath::sin(out[n] * two_pi);
+                    out[n] = std::copysign(fastmath::exp2(exponent * fastmath::log2(std::abs(sine) + 1e-30f)), sine);
+                }
+            } else {
+                for (int n = 0; n < num_samples; ++n)
+                    out[n] = fastmath::sin(out[n] * two_pi);
+            }
+        }
+        else if constexpr (W == Wave::Triangle) {
+            // The triangle is the lower of its rising and falling lines
+            const float a = 0.5f + s * 0.5f;
+            const float rise = 2.0f / std::max(a, 1e-6f), fall = 2.0f / std::max(1.0f - a, 1e-6f);
+            
+            for (int n = 0; n < num_samples; ++n)
+                out[n] = std::min(out[n] * rise, (1.0f - out[n]) * fall) - 1.0f;
+        }
+        else /* (W == Wave::Square) */ {
+            const float width = s * 0.49f + 0.5f;
+            
+            for (int n = 0; n < num_samples; ++n)
+                out[n] = 1.0f - 2.0f * (float)(out[n] >= width);
+        }
+    }
+    
+    void render_random(float* out, const float* rate_cv, const float* shape_cv, int num_samples, float block_shape, float block_phase) {
+        const double block_rate = rate;
+        const bool is_note_mode = note_mode;
+        const double block_increment = freq * increment;
+        
+        for (int n = 0; n < num_samples; ++n) {
+            const double sample_increment = rate_cv != nullptr
+                                          ? get_freq(clip(block_rate + (double)rate_cv[n], 0.0, 1.0), is_note_mode) * increment
+                                          : block_increment;
+            const float sample_shape = shape_cv != nullptr ? clip(block_shape + shape_cv[n], -1.0f, 1.0f) : block_shape;
+            
+            const double next_position = position + sample_increment;
+            
+            out[n] = get_random(random_value, next_random_value, (float)(position + (double)block_phase), sample_shape);
+            
+            if (next_position >= 1.0) {
+                random_value = next_random_value;
+                next_random_value = rng.nextBipolar();
+            }
+            
+            position = mod(next_position, 1.0);
+        }
     }
 };
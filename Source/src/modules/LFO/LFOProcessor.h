@@ -19,6 +19,9 @@
 */
 struct LFOProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { rate, wave, shape };
+    
     LFOProcessor() :
     ModuleProcessor(
         2, // Inlets
@@ -52,22 +55,29 @@ struct LFOProcessor : ModuleProcessor
     ~LFOProcessor() {}
     
     void prepare (double newSampleRate, int maxBlockSize) override {
-        lfo.prepare(newSampleRate);
+        lfo.prepare(newSampleRate, getRandomSeed());
     }
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
     {
-        float* samples = buffer.getWritePointer(0);
-        const float* rateCVSamples = buffer.getReadPointer(0);
-        const float* shapeCVSamples = buffer.getReadPointer(1);
-
-        for (int n = 0; n < buffer.getNumSamples(); n++)
-        {
-            lfo.set_rate(clip(rate + *rateCVSamples++, 0.0f, 1.0f));
-            lfo.set_shape(clip(shape + *shapeCVSamples++, 0.0f, 1.0f));
-            *samples++ = lfo.next();
+        const int numSamples = buffer.getNumSamples();
+        auto& connections = getConnections();
+        
+        lfo.set_rate(clip(rate.getValue(), 0.0f, 1.0f));
+        lfo.set_shape(shape.getValue());
+        
+        // Nobody's listening, just keep the phase running
+        if (!connections.isOutletConnected(0) && !connections.isInletConnected(0)) {
+            lfo.skip(numSamples);
+            return;
         }
         
+        // The LFO renders in place, over the rate inlet
+        const float* rateCV = getModulation(rate, buffer.getWritePointer(0), connections.isInletConnected(0), numSamples);
+        const float* shapeCV = getModulation(shape, buffer.getWritePointer(1), connections.isInletConnected(1), numSamples);
+        
+        lfo.render(buffer.getWritePointer(0), rateCV, shapeCV, numSamples);
+        
         
 //        float* samples = buffer.getWritePointer(0);
 //        const float* freqCVSamples = buffer.getReadPointer(0);
@@ -84,15 +94,33 @@ struct LFOProcessor : ModuleProcessor
 //        }
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "rate") rate = value;
-        else if (parameterID == "wave") lfo.set_wave((LFO::Wave)floor(value));
-        else if (parameterID == "shape") shape = value * 0.01f;
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::rate: rate.setTarget(value); break;
+            case Param::wave: lfo.set_wave((LFO::Wave)floor(value)); break;
+            case Param::shape: shape.setTarget(value * 0.01f); break;
+        }
     }
     
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<LFOUI>(*this); }
     
 private:
     LFO lfo;
-    float rate = 0.0f, shape = 1.0f;
+    ParameterSmoother rate { *this, ParameterSmoother::Linear };
+    ParameterSmoother shape { *this, ParameterSmoother::Linear };
+    
+    /// The LFO takes a parameter's value once per block, a ramp in progress is added to the inlet's CV instead (nullptr when there's neither)
+    static const float* getModulation(const ParameterSmoother& smoother, float* cv, bool isConnected, int numSamples) noexcept
+    {
+        if (smoother.isSteady())
+            return isConnected ? cv : nullptr;
+        
+        const float* samples = smoother.getSamples();
+        const float value = smoother.getValue();
+        
+        for (int n = 0; n < numSamples; ++n)
+            cv[n] += samples[n] - value;
+        
+        return cv;
+    }
 };
@@ -19,12 +19,18 @@
 */
 struct StringProcessor : ModuleProcessor
 {
+    /// Parameter indices, in the order they're declared below
+    enum class Param { freq, damp, pos, decay, mode, exact, interval };
+    
+    /// The frequency range, including CV (the delay lines are sized for the lowest one)
+    static constexpr float minFrequency = 20.0f, maxFrequency = 10000.0f;
+    
     StringProcessor() :
     ModuleProcessor(5, 1,
         std::make_unique<FloatParameter> (
             "freq",
             "Frequency",
-            juce::NormalisableRange<float>(20.0f, 10000.0f, 0.0, 0.3f),
+            juce::NormalisableRange<float>(minFrequency, maxFrequency, 0.0, 0.3f),
             220.0f,
             FloatParameter::Attributes{}.withLabel("Hz")
         ),
@@ -53,72 +59,113 @@ struct StringProcessor : ModuleProcessor
             "mode" ,
             "Mode"     ,
             false
+        ),
+        std::make_unique<juce::AudioParameterBool>  (
+            "exact",
+            "Exact",
+            false
+        ),
+        std::make_unique<juce::AudioParameterInt> (
+            "interval",
+            "Interval",
+            1,
+            maxControlInterval,
+            defaultControlInterval
         )
     )
     {}
     
+    /// Coefficients are computed every this many samples (the interval parameter) and interpolated in between, see usesExactCoefficients()
+    static constexpr int defaultControlInterval = 16, maxControlInterval = 64;
+    
     ~StringProcessor() {}
     
     void prepare (double newSampleRate, int maxBlockSize) override
     {
         sampleRate = newSampleRate;
-        line1.resize(newSampleRate);
-        line2.resize(newSampleRate);
+        voices = std::make_unique<Voice[]>((size_t)getNumVoices());
         
-        line1.clear();
-        line2.clear();
+        // The longest interval (plus the interpolation's next sample) is the period of the lowest frequency
+        const size_t lineSize = Line::roundSize((size_t)std::ceil(newSampleRate / minFrequency) + 2);
         
-        onePole1.prepare(newSampleRate);
-        onePole2.prepare(newSampleRate);
-        
-        dcBlock.prepare(newSampleRate);
-        accum.reset();
-       
+        for (int i = 0; i < getNumVoices(); ++i) {
+            auto& voice = voices[(size_t)i];
+            
+            voice.line1.setMemory(allocate<float>(lineSize), lineSize);
+            voice.line2.setMemory(allocate<float>(lineSize), lineSize);
+            
+            voice.line1.clear();
+            voice.line2.clear();
+            
+            voice.onePole1.prepare(newSampleRate);
+            voice.onePole2.prepare(newSampleRate);
+            
+            voice.dcBlock.prepare(newSampleRate);
+            voice.accum.reset();
+        }
     }
     
     void process (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
     {
-        const float* inputSamples = buffer.getReadPointer(0);
-        const float* freqCVSamples = buffer.getReadPointer(1);
-        const float* posCVSamples = buffer.getReadPointer(2);
-        const float* dampCVSamples = buffer.getReadPointer(3);
-        const float* decayCVSamples = buffer.getReadPointer(4);
+        if (buffer.getNumSamples() == 0) return;
         
-        float* outputSamples = buffer.getWritePointer(0);
-        
-        // Mode B doubles the (perceived) interval so we must divide it accordingly
-        float modeFactor = mode == Mode::B ? 0.5f : 1.0f;
+        for (int voice = 0; voice < getNumVoices(); ++voice)
+            processVoice(buffer, voice);
+    }
+    
+    /// Coefficients follow the CV one control interval late here (there's no looking ahead), ramping towards each new set
+    void processSample (float* ports, int index) override
+    {
+        const int interval = usesExactCoefficients() ? 1 : controlInterval;
         
-        for (int n = 0; n < buffer.getNumSamples(); n++)
-        {
-            float periodInSamples = sampleRate / (double)std::min(frequency * pow(5.0f, *freqCVSamples++), 10000.0f);
-            
-            float scaledDecay = scaleDecay(clip(decay + *decayCVSamples++, 0.0f, 1.0f), mode);
-            float feedback = getFeedback(periodInSamples, scaledDecay);
-            float dampHz = pow(1.0f - clip(damp + *dampCVSamples++, 0.0f, 1.0f), 3.0f) * 20000.0f;
-            
-            // The interval to apply to each delay line
-            float interval = periodInSamples * modeFactor;
+        for (int voiceIndex = 0; voiceIndex < getNumVoices(); ++voiceIndex) {
+            auto& voice = voices[(size_t)voiceIndex];
+            auto& coefficients = voice.coefficients;
             
-            // Pickup position is always a fraction of the interval
-            float line1Pos = interval * clip(pos + *posCVSamples++, 0.0f, 1.0f);
-            float line2Pos = interval - line1Pos;
+            if (index % interval == 0) {
+                const auto target = getCoefficients(voice, frequency.getSamples()[index], ports[getChannel(1, voiceIndex)],
+                                                    damp.getSamples()[index], ports[getChannel(3, voiceIndex)],
+                                                    decay.getSamples()[index], ports[getChannel(4, voiceIndex)]);
+                
+                if (!voice.hasCoefficients) {
+                    coefficients = target;
+                    voice.hasCoefficients = true;
+                }
+                
+                voice.increments = {
+                    (target.interval - coefficients.interval) / (float)interval,
+                    (target.feedback - coefficients.feedback) / (float)interval,
+                    (target.damping - coefficients.damping) / (float)interval
+                };
+            }
             
-            float input = (*inputSamples++) * 0.05f;
+            coefficients.interval += voice.increments.interval;
+            coefficients.feedback += voice.increments.feedback;
+            coefficients.damping += voice.increments.damping;
             
-            line1.push( processLine1Node(input, dampHz, feedback, interval, mode) );
-            line2.push( processLine2Node(input, dampHz, feedback, interval) );
-            
-            *outputSamples++ = readOutput(line1Pos, line2Pos);
+            auto& sample = ports[getChannel(0, voiceIndex)];
+            sample = processSample(voice, sample, coefficients.interval, coefficients.feedback, coefficients.damping,
+                                   pos.getSamples()[index] + ports[getChannel(2, voiceIndex)]);
         }
     }
     
-    void parameterChanged (const juce::String& parameterID, float value) override {
-        if (parameterID == "mode") mode = (Mode)value;
-        else if (parameterID == "damp") damp = value * 0.01f;
-        else if (parameterID == "freq") frequency = value;
-        else if (parameterID == "decay") decay = value * 0.01f;
-        else if (parameterID == "pos") pos = value * 0.01f;
+    bool supportsSampleProcessing() const override { return true; }
+    
+    int getMaxNumVoices() const override { return maxNumVoices; }
+    
+    /// The sine waveshaper in the feedback loop folds its harmonics back down at high pitches
+    int getMaxOversamplingFactor() const override { return 8; }
+    
+    void parameterChanged (int parameterIndex, float value) override {
+        switch ((Param)parameterIndex) {
+            case Param::freq: frequency.setTarget(value); break;
+            case Param::damp: damp.setTarget(value * 0.01f); break;
+            case Param::pos: pos.setTarget(value * 0.01f); break;
+            case Param::decay: decay.setTarget(value * 0.01f); break;
+            case Param::mode: mode = (Mode)value; break;
+            case Param::exact: exact = value > 0.5f; break;
+            case Param::interval: controlInterval = std::max(1, (int)value); break;
+        }
     }
     
     std::unique_ptr<ModuleUI> createUI() override { return std::make_unique<StringUI>(*this); }
@@ -126,20 +173,145 @@ struct StringProcessor : ModuleProcessor
 private:
     float sampleRate = 44100.0f;
     
-    DelayLine<float> line1, line2;
-    OnePole<float> onePole1, onePole2;
-    DCBlock<float> dcBlock;
-    Accum<float> accum;
+    using Line = DelayLine<float, DelayWrap::PowerOfTwo>;
+    
+    /// Everything the audio rate loop needs that's expensive to compute
+    struct Coefficients {
+        /// The delay applied to each line
+        float interval;
+        float feedback;
+        /// The coefficient of both damping filters
+        float damping;
+    };
+    
+    /// The state of a single string, there's one per voice
+    struct Voice {
+        Line line1, line2;
+        OnePole<float> onePole1, onePole2;
+        DCBlock<float> dcBlock;
+        Accum<float> accum;
+        
+        /// The ones used for the last sample
+        Coefficients coefficients;
+        bool hasCoefficients = false;
+        
+        /// The steps towards the next set, when running sample by sample
+        Coefficients increments {};
+    };
+    
+    std::unique_ptr<Voice[]> voices;
+    
+    void processVoice (juce::AudioBuffer<float>& buffer, int voiceIndex)
+    {
+        auto& voice = voices[(size_t)voiceIndex];
+        
+        const float* inputSamples = buffer.getReadPointer(getChannel(0, voiceIndex));
+        const float* freqCVSamples = buffer.getReadPointer(getChannel(1, voiceIndex));
+        const float* posCVSamples = buffer.getReadPointer(getChannel(2, voiceIndex));
+        const float* dampCVSamples = buffer.getReadPointer(getChannel(3, voiceIndex));
+        const float* decayCVSamples = buffer.getReadPointer(getChannel(4, voiceIndex));
+        
+        float* outputSamples = buffer.getWritePointer(getChannel(0, voiceIndex));
+        
+        const int numSamples = buffer.getNumSamples();
+        
+        const float* frequencySamples = frequency.getSamples();
+        const float* dampSamples = damp.getSamples();
+        const float* decaySamples = decay.getSamples();
+        const float* posSamples = pos.getSamples();
+        
+        // How many samples share a set of coefficients, slow, straight CV with steady parameters only needs them at the end of the block
+        int interval = usesExactCoefficients() ? 1 : controlInterval;
+        
+        if (interval > 1 && frequency.isSteady() && damp.isSteady() && decay.isSteady())
+            interval = numSamples;
+        
+        for (int start = 0; start < numSamples; start += interval) {
+            const int length = std::min(interval, numSamples - start);
+            const int last = start + length - 1;
+            
+            // Computed at the last sample of each stretch and ramped from the last one of the previous stretch
+            const auto target = getCoefficients(voice, frequencySamples[last], freqCVSamples[last],
+                                                dampSamples[last], dampCVSamples[last],
+                                                decaySamples[last], decayCVSamples[last]);
+            const auto previous = voice.hasCoefficients ? voice.coefficients : target;
+            
+            BlockRamp<float> delay (previous.interval + (target.interval - previous.interval) / (float)length, target.interval, length);
+            BlockRamp<float> feedback (previous.feedback + (target.feedback - previous.feedback) / (float)length, target.feedback, length);
+            BlockRamp<float> damping (previous.damping + (target.damping - previous.damping) / (float)length, target.damping, length);
+            
+            for (int n = start; n <= last; n++)
+                outputSamples[n] = processSample(voice, inputSamples[n], delay.next(), feedback.next(), damping.next(), posSamples[n] + posCVSamples[n]);
+            
+            voice.coefficients = target;
+            voice.hasCoefficients = true;
+        }
+    }
+    
+    Coefficients getCoefficients(const Voice& voice, float frequency, float freqCV, float damp, float dampCV, float decay, float decayCV) const
+    {
+        const float periodInSamples = getPeriodInSamples(frequency, freqCV);
+        
+        // Mode B doubles the (perceived) interval so we must divide it accordingly
+        const float modeFactor = mode == Mode::B ? 0.5f : 1.0f;
+        
+        return {
+            periodInSamples * modeFactor,
+            getFeedback(periodInSamples, scaleDecay(clip(decay + decayCV, 0.0f, 1.0f), mode)),
+            voice.onePole1.getMixFactor(getDampHz(damp, dampCV))
+        };
+    }
     
     enum class Mode {A, B} mode = Mode::A;
-    float damp = 0.0f, frequency = 20.0f, decay = 0.0f, pos = 0.0f;
     
-    float processLine1Node(float input, float dampHz, float feedback, float interval, Mode mode)
+    /// Computes the coefficients for every sample, whatever the CV
+    bool exact = false;
+    int controlInterval = defaultControlInterval;
+    
+    /// Coefficients ramped across a control interval would miss what audio rate CV does in between
+    bool usesExactCoefficients() const noexcept
+    {
+        auto& connections = getConnections();
+        return exact || !connections.isControlRate(1) || !connections.isControlRate(3) || !connections.isControlRate(4);
+    }
+    
+    ParameterSmoother frequency { *this, ParameterSmoother::Exponential };
+    ParameterSmoother damp { *this, ParameterSmoother::Linear };
+    ParameterSmoother decay { *this, ParameterSmoother::Linear };
+    ParameterSmoother pos { *this, ParameterSmoother::Linear };
+    
+    /// @param damping The damping filters' coefficient, see OnePole::getMixFactor()
+    /// @param position The pickup position, including its CV
+    float processSample(Voice& voice, float input, float interval, float feedback, float damping, float position)
+    {
+        // Pickup position is always a fraction of the interval (the interval being what we apply to each delay line)
+        float line1Pos = interval * clip(position, 0.0f, 1.0f);
+        float line2Pos = interval - line1Pos;
+        
+        input *= 0.05f;
+        
+        voice.line1.push( processLine1Node(voice, input, damping, feedback, interval, mode) );
+        voice.line2.push( processLine2Node(voice, input, damping, feedback, interval) );
+        
+        return readOutput(voice, line1Pos, line2Pos);
+    }
+    
+    float getPeriodInSamples(float frequency, float freqCV) const
+    {
+        return sampleRate / (double)clip(frequency * fastmath::pow(5.0f, freqCV), minFrequency, maxFrequency);
+    }
+    
+    float getDampHz(float damp, float dampCV) const
+    {
+        return pow(1.0f - clip(damp + dampCV, 0.0f, 1.0f), 3.0f) * 20000.0f;
+    }
+    
+    float processLine1Node(Voice& voice, float input, float damping, float feedback, float interval, Mode mode)
     {
-        onePole1.setCutoff(dampHz);
+        voice.onePole1.setMixFactor(damping);
         
         // Line 1 gets a "special" function to liven the sound up a bit...
-        float line1Node = sinf( onePole1.process( input + line1.getInterpolated( interval ) ) * juce::MathConstants<float>::twoPi * 1.5f );
+        float line1Node = fastmath::sin( voice.onePole1.process( input + voice.line1.getInterpolated( interval ) ) * juce::MathConstants<float>::twoPi * 1.5f );
         
         // Apply decay
         line1Node *= feedback * 0.1063f;
@@ -150,28 +322,28 @@ private:
         return line1Node;
     }
     
-    float processLine2Node(float input, float dampHz, float feedback, float interval)
+    float processLine2Node(Voice& voice, float input, float damping, float feedback, float interval)
     {
-        onePole2.setCutoff(dampHz);
+        voice.onePole2.setMixFactor(damping);
         
         // Normal case for Line 2
         // read from delay line, apply low pass and feedback (decay)
-        float line2Node = onePole2.process( -input + line2.getInterpolated( interval ) ) * feedback;
+        float line2Node = voice.onePole2.process( -input + voice.line2.getInterpolated( interval ) ) * feedback;
         return line2Node;
     }
     
-    float readOutput(float line1Pos, float line2Pos)
+    float readOutput(Voice& voice, float line1Pos, float line2Pos)
     {
         // Read from the delay line with the current position, integrate and highpass (dcblock)
-        return dcBlock.process( accum.process( line1.getInterpolated( line1Pos ) + line2.getInterpolated( line2Pos )));
+        return voice.dcBlock.process( voice.accum.process( voice.line1.getInterpolated( line1Pos ) + voice.line2.getInterpolated( line2Pos )));
     }
     
-    constexpr float scaleDecay(float decay, Mode mode)
+    constexpr float scaleDecay(float decay, Mode mode) const
     {
         return pow(decay, mode == Mode::B ? 0.0005f : 0.05f);
     }
     
-    constexpr float getFeedback(float periodInSamples, float decay) {
+    constexpr float getFeedback(float periodInSamples, float decay) const {
         float exponent = periodInSamples * (0.01f + (mode == Mode::B ? 0.52f : 0.0f));
         return pow(decay, exponent) * 0.997f;
     }
@@ -23,22 +23,27 @@ public:
         .name =  "String",
         .inlets = {"In", "Freq", "Pos", "Damp", "Decay"},
         .outlets = {"Out"},
-        .defaultSize = {210, 260},
-        .minimumSize = {200, 196},
+        .defaultSize = {260, 260},
+        .minimumSize = {240, 196},
         .processor = processor
     }),
     frequencyDial(*processor.params.getParameter("freq")),
     positionDial(*processor.params.getParameter("pos")),
     dampDial(*processor.params.getParameter("damp")),
     decayDial(*processor.params.getParameter("decay")),
+    intervalDial(*processor.params.getParameter("interval")),
     modeButton("A", "B"),
-    modeAttachment(*processor.params.getParameter("mode"), modeButton)
+    modeAttachment(*processor.params.getParameter("mode"), modeButton),
+    exactButton("Fast", "Exact"),
+    exactAttachment(*processor.params.getParameter("exact"), exactButton)
     {
         addAndMakeVisible(frequencyDial);
         addAndMakeVisible(positionDial);
         addAndMakeVisible(dampDial);
         addAndMakeVisible(decayDial);
+        addAndMakeVisible(intervalDial);
         addAndMakeVisible(modeButton);
+        addAndMakeVisible(exactButton);
     }
     
     ~StringUI() {}
@@ -49,22 +54,31 @@ public:
     {
         auto bounds = getLocalBounds();
         
-        modeButton.setBounds(bounds.removeFromBottom(30).withSizeKeepingCentre(70, 30));
+        auto buttons = bounds.removeFromBottom(30);
+        modeButton.setBounds(buttons.removeFromLeft(buttons.getWidth() / 2).withSizeKeepingCentre(70, 30));
+        exactButton.setBounds(buttons.withSizeKeepingCentre(70, 30));
         
         int rowPadding = 10;
         int rowHeight = (bounds.getHeight() - rowPadding) / 2;
         
         auto topRow = bounds.removeFromTop(rowHeight);
+        intervalDial.setBounds( topRow.removeFromRight(topRow.getWidth() / 3) );
         frequencyDial.setBounds( topRow.removeFromLeft(topRow.getWidth() / 2) );
         decayDial.setBounds( topRow );
         
         auto bottomRow = bounds.removeFromBottom(rowHeight);
+        bottomRow.removeFromRight(bottomRow.getWidth() / 3);
         positionDial.setBounds( bottomRow.removeFromLeft(bottomRow.getWidth() / 2) );
         dampDial.setBounds( bottomRow );
     }
 
 private:
     PhiDial frequencyDial, positionDial, dampDial, decayDial;
+    /// The control interval, in samples
+    PhiDial intervalDial;
     PhiSliderButton modeButton;
     juce::ButtonParameterAttachment modeAttachment;
+    /// Computes the coefficients for every sample instead of at the control rate (audio rate CV always does)
+    PhiSliderButton exactButton;
+    juce::ButtonParameterAttachment exactAttachment;
 };
@@ -25,8 +25,15 @@ moduleID(moduleID)
         state.setModuleEnabled(moduleID, powerButton.getToggleState());
     };
     
+    voicesButton.onClick = [&] () { openVoicesMenu(); };
+    oversamplingButton.onClick = [&] () { openOversamplingMenu(); };
+    
     addAndMakeVisible(*moduleUI);
     addAndMakeVisible(powerButton);
+    addChildComponent(voicesButton);
+    voicesButton.setVisible(moduleUI->props.processor.getMaxNumVoices() > 1);
+    addChildComponent(oversamplingButton);
+    oversamplingButton.setVisible(moduleUI->props.processor.getMaxOversamplingFactor() > 1);
     
     for (auto& inletName : moduleUI->props.inlets) {
         inlets.push_back(std::make_unique<InletUI>(inletName));
@@ -156,6 +163,12 @@ void ModuleBox::enforceSizeLimits() {
     minWidth += juce::GlyphArrangement::getStringWidth(lookandfeel.withDefaultMetrics({}), moduleUI->props.name);
     minWidth += padding; // Plus some right padding
     
+    if (voicesButton.isVisible())
+        minWidth += voicesButtonWidth + padding;
+    
+    if (oversamplingButton.isVisible())
+        minWidth += oversamplingButtonWidth + padding;
+    
     auto maxSize = moduleUI->props.minimumSize;
     maxSize.width *= 2;
     maxSize.height *= 2;
@@ -198,6 +211,14 @@ void ModuleBox::resized()
     powerButton.setBounds(header.removeFromLeft(padding * 2 + powerButtonSize)
         .withSizeKeepingCentre(powerButtonSize, powerButtonSize));
     
+    // Place Voices button
+    if (voicesButton.isVisible())
+        voicesButton.setBounds(header.removeFromRight(voicesButtonWidth + padding).withTrimmedRight(padding));
+    
+    // Place Oversampling button
+    if (oversamplingButton.isVisible())
+        oversamplingButton.setBounds(header.removeFromRight(oversamplingButtonWidth + padding).withTrimmedRight(padding));
+    
     // Place Text
     nameRectangle = header.toFloat();
     
@@ -307,6 +328,48 @@ void ModuleBox::moduleColourChanged(ModuleID id, const juce::Colour& colour) {
     }
 }
 
+void ModuleBox::moduleVoicesChanged(ModuleID id, int numVoices) {
+    if (id == moduleID)
+        voicesButton.setValue(numVoices);
+}
+
+void ModuleBox::moduleOversamplingChanged(ModuleID id, int factor) {
+    if (id == moduleID)
+        oversamplingButton.setValue(factor);
+}
+
+void ModuleBox::openVoicesMenu() {
+    const int maxNumVoices = moduleUI->props.processor.getMaxNumVoices();
+    
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Voices");
+    
+    for (int numVoices = 1; numVoices <= maxNumVoices; numVoices *= 2)
+        menu.addItem(numVoices, juce::String(numVoices), true, numVoices == voicesButton.getValue());
+    
+    // Returns the number of voices (0 if clicked outside)
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(voicesButton), [&] (int result) {
+        if (result > 0)
+            state.setModuleVoices(moduleID, result);
+    });
+}
+
+void ModuleBox::openOversamplingMenu() {
+    const int maxFactor = moduleUI->props.processor.getMaxOversamplingFactor();
+    
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Oversampling");
+    
+    for (int factor = 1; factor <= maxFactor; factor *= 2)
+        menu.addItem(factor, factor > 1 ? juce::String(factor) + "x" : juce::String("Off"), true, factor == oversamplingButton.getValue());
+    
+    // Returns the factor (0 if clicked outside)
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(oversamplingButton), [&] (int result) {
+        if (result > 0)
+            state.setModuleOversampling(moduleID, result);
+    });
+}
+
 void ModuleBox::connectionCreated(ConnectionID id) {
     if (id.source.moduleID == moduleID) {
         numOutletsConnected++;
@@ -44,6 +44,8 @@ private:
     const float selectedOutlineThickness = 2.0f;
     const float roundness = 2.0f;
     const int powerButtonSize = 15;
+    const int voicesButtonWidth = 24;
+    const int oversamplingButtonWidth = 28;
 
     /// Our LookAndFeel class and instance for this module box
     struct ModuleLookAndFeel : PhiLookAndFeel
@@ -99,6 +101,35 @@ private:
     
     /// The top-left button for enabling and disabling the contained module
     PhiToggleButton powerButton;
+    
+    /// A setting in the top-right of the header that opens a menu, highlighted when it's above 1
+    struct MenuButton : juce::Button {
+        MenuButton(const juce::String& name, std::function<juce::String(int)> getText) : Button(name), getText(std::move(getText)) {}
+        
+        void setValue(int newValue) { value = newValue; repaint(); }
+        int getValue() const { return value; }
+        
+    private:
+        int value = 1;
+        std::function<juce::String(int)> getText;
+        
+        void paintButton (juce::Graphics& g, bool shouldDrawButtonAsHighlighted, bool) override {
+            g.setColour(findColour(value > 1 || shouldDrawButtonAsHighlighted ? PhiColourIds::Module::Highlight : PhiColourIds::Module::Name));
+            g.drawText(getText(value), getLocalBounds(), juce::Justification::centredRight, false);
+        }
+    };
+    
+    /// The voice count, only shown on modules that can run more than one voice
+    MenuButton voicesButton { "Voices", [] (int numVoices) { return "x" + juce::String(numVoices); } };
+    
+    /// The oversampling factor, only shown on modules that can oversample
+    MenuButton oversamplingButton { "Oversampling", [] (int factor) { return factor > 1 ? "OS" + juce::String(factor) : juce::String("OS"); } };
+    
+    /// Lets the user pick the number of voices, up to the processor's maximum
+    void openVoicesMenu();
+    
+    /// Lets the user pick the oversampling factor, up to the processor's maximum
+    void openOversamplingMenu();
 
     /// Imposes a draggable corner on the component for resizing
     juce::ResizableCornerComponent resizer;
@@ -142,6 +173,8 @@ private:
 
     void moduleEnabledChanged(ModuleID, bool) override;
     void moduleColourChanged(ModuleID, const juce::Colour&) override;
+    void moduleVoicesChanged(ModuleID, int) override;
+    void moduleOversamplingChanged(ModuleID, int) override;
     void connectionCreated(ConnectionID) override;
     void connectionDeleted(ConnectionID) override;
 
@@ -142,6 +142,8 @@ bool Patcher::keyPressed (const juce::KeyPress& key)
 {
     if (key == juce::KeyPress::backspaceKey)
     {
+        State::ScopedTransaction transaction (state);
+        
         for (auto moduleID : selectedModuleIDs)
             state.deleteModule(moduleID);
         